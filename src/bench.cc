@@ -27,7 +27,12 @@
 #include "board.h"
 #include "clock.h"
 #include "eval.h"
+#include "pgn.h"
 
+#include <errno.h>
+#include <string.h>
+
+#if defined(HOICHESS)
 const char * Bench::fens[] = {
 	/* positions of Bratko-Kopec test */
 	"1k1r4/pp1b1R2/3q2pp/4p3/2B5/4Q3/PPP2B2/2K5 b - - 0 1",
@@ -68,6 +73,31 @@ const char * Bench::fens[] = {
 	NULL
 };
 
+/* Only the positions of the Bratko-Kopec test, at the beginning of fens[],
+ * are used for search benchmarks. The artificial positions are useless
+ * there, because their quiescence search explodes. */
+const unsigned int Bench::nr_search_fens = 24;
+
+#elif defined(HOIXIANGQI)
+const char * Bench::fens[] = {
+	/* opening position, and some positions of a self-play game */
+	"rnefkfenr/9/1o5o1/p1p1p1p1p/9/9/P1P1P1P1P/1O5O1/9/RNEFKFENR w - - 0 1",
+	"1refkfenr/9/7o1/O3p3p/9/9/o3P3P/9/9/RNEFKFENR w - - 0 6",
+	"2efkfen1/9/o8/4p4/9/8R/r3P4/2N6/9/2EFKFEN1 w - - 0 11",
+	"2efkf2R/9/3oe4/9/4pn3/9/N8/8N/9/2EFKFE2 w - - 0 16",
+	"2ef1k3/4f4/4e4/9/3opn1R1/9/N8/E7N/4F4/3K1FE2 w - - 10 21",
+	"2ef1k3/4f2R1/9/9/2eopn3/2N6/9/E4F2N/4F4/4K1E2 w - - 20 26",
+	"3f1k3/3of2R1/4e4/9/2e1Nn3/2E6/9/4EF2N/4F4/4K4 w - - 7 31",
+
+	NULL
+};
+
+const unsigned int Bench::nr_search_fens = 7;
+
+#else
+# error "neither HOICHESS nor HOIXIANGQI defined"
+#endif
+
 
 Bench::Bench()
 {
@@ -228,13 +258,29 @@ void Bench::bench_evaluator()
 	log("bench evaluator finished\n");
 }
 
+/*
+ * Measure the speed of making moves, once by copying the board and calling
+ * make_move on the copy, and once by make_move/unmake_move cycles on the
+ * same board (if compiled with USE_UNMAKE_MOVE). The method used by the
+ * search is marked with an asterisk.
+ */
 void Bench::bench_makemove()
 {
 	printf("Running makemove benchmark...\n");
 	log("bench makemove\n");
 
-	float mps_sum = 0;
-	unsigned int mps_cnt = 0;
+	enum { COPY_MAKE, MAKE_UNMAKE };
+	static const char * const methods[] = { "copy/make", "make/unmake" };
+#ifdef USE_UNMAKE_MOVE
+	const int nr_methods = 2;
+	const int search_method = MAKE_UNMAKE;
+#else
+	const int nr_methods = 1;
+	const int search_method = COPY_MAKE;
+#endif
+
+	float mps_sum[2] = { 0, 0 };
+	unsigned int mps_cnt[2] = { 0, 0 };
 	for (const char ** p = &fens[0]; *p != NULL; p++) {
 		const char * fen = *p;
 		if (verbose >= 2) {
@@ -245,52 +291,254 @@ void Bench::bench_makemove()
 		Board newboard;
 		Movelist movelist;
 		board.generate_moves(&movelist);
-		Clock clock(1);
-		clock.start();
-		unsigned long moves = 0;
-		while (!clock.timeout()) {
-			for (unsigned int i=0; i<1000; i++) {
-				for (unsigned int k=0; k<movelist.size(); k++) {
-					Move mov = movelist[k];
-					ASSERT_DEBUG(mov.is_valid(board));
-					/* We must copy the behavior of search,
-					 * i.e., run make_move/unmake_move
-					 * cycles, or, in case unmake_move is
-					 * disabled, copy the board and call
-					 * make_move on the copy. */
+		for (int method = 0; method < nr_methods; method++) {
+			Clock clock(1);
+			clock.start();
+			unsigned long moves = 0;
+			while (!clock.timeout()) {
+				for (unsigned int i=0; i<1000; i++) {
+					for (unsigned int k=0;
+						k<movelist.size(); k++) {
+						Move mov = movelist[k];
+						ASSERT_DEBUG(mov.is_valid(board));
 #ifdef USE_UNMAKE_MOVE
-					BoardHistory hist
-						= board.make_move(mov);
-					board.unmake_move(hist);
-#else
-					newboard = board;
-					newboard.make_move(mov);
+						if (method == MAKE_UNMAKE) {
+							BoardHistory hist
+							  = board.make_move(mov);
+							board.unmake_move(hist);
+							moves++;
+							continue;
+						}
 #endif
-					moves++;
+						newboard = board;
+						newboard.make_move(mov);
+						moves++;
+					}
 				}
 			}
-		}
-		clock.stop();
-		
-		float secs = (float) clock.get_elapsed_time() / 100;
-		float mps;
-		if (moves > 0 && secs > 0) {
-			mps = moves / secs;
-			mps_sum += mps;
-			mps_cnt++;
+			clock.stop();
 
-			log("position='%s', moves=%lu, time=%.2f, speed=%.0f\n",
-					fen, moves, secs, mps);
-			if (verbose >= 2) {
-				printf("\tMoves made: %lu in %.2f s"
+			float secs = (float) clock.get_elapsed_time() / 100;
+			float mps;
+			if (moves > 0 && secs > 0) {
+				mps = moves / secs;
+				mps_sum[method] += mps;
+				mps_cnt[method]++;
+
+				log("position='%s', method=%s, moves=%lu,"
+						" time=%.2f, speed=%.0f\n",
+						fen, methods[method],
+						moves, secs, mps);
+				if (verbose >= 2) {
+					printf("\t%-12s Moves made: %lu"
+						" in %.2f s"
 						" (%.1fk moves/s)\n",
-						moves, secs, mps / 1000);
+						methods[method], moves, secs,
+						mps / 1000);
+				}
 			}
 		}
 	}
-	
-	float mps_avg = (mps_cnt > 0) ? (mps_sum / mps_cnt) : 0;
-	printf("Average makemove speed: %.1fk moves/s\n", mps_avg / 1000);	
-	log("mps_avg=%.0f\n", mps_avg);
+
+	for (int method = 0; method < nr_methods; method++) {
+		float mps_avg = (mps_cnt[method] > 0)
+			? (mps_sum[method] / mps_cnt[method]) : 0;
+		printf("Average makemove speed (%s):%s %.1fk moves/s%s\n",
+				methods[method],
+				method == COPY_MAKE ? "  " : "",
+				mps_avg / 1000,
+				method == search_method ? " *" : "");
+		log("method=%s, mps_avg=%.0f\n", methods[method], mps_avg);
+	}
 	log("bench makemove finished\n");
 }
+
+/*
+ * Search all benchmark positions to the given depth with a single thread,
+ * with all tables cleared before each position. The total number of nodes
+ * does not depend on the machine, and changes only if the search does, so
+ * it serves as a signature of the search.
+ */
+void Bench::bench_search(Search * search, unsigned int depth)
+{
+	ASSERT(search != NULL);
+
+	printf("Running search benchmark (depth %u)...\n", depth);
+	log("bench search\n");
+
+	const unsigned int old_threads = search->get_threads();
+	const unsigned int old_depth = search->get_depthlimit();
+	search->set_threads(1);
+	search->set_depthlimit(depth);
+
+	unsigned long nodes = 0;
+	unsigned int csecs = 0;
+	for (unsigned int i=0; i<nr_search_fens; i++) {
+		const char * fen = fens[i];
+		Board board(fen);
+		search->clear_tables();
+
+		Clock clock;
+		clock.start();
+		search->start(board, Clock(), Search::ANALYZE);
+		unsigned int c = clock.stop();
+		csecs += c;
+		nodes += search->get_nodes();
+
+		if (verbose >= 2) {
+			printf("\tPosition: %s\n", fen);
+			printf("\tNodes: %lu in %.2f s\n", search->get_nodes(),
+					(float) c / 100);
+		}
+		log("position='%s', nodes=%lu, time=%.2f\n",
+				fen, search->get_nodes(), (float) c / 100);
+	}
+
+	float secs = (float) csecs / 100;
+	printf("Nodes searched: %lu\n", nodes);
+	printf("Search time: %.2f s\n", secs);
+	if (csecs > 0) {
+		printf("Search speed: %.1fk nodes/s\n", nodes / secs / 1000);
+	}
+	log("nodes=%lu, time=%.2f\n", nodes, secs);
+
+	search->set_threads(old_threads);
+	search->set_depthlimit(old_depth);
+	log("bench search finished\n");
+}
+
+/*
+ * Measure time-to-depth scaling of the parallel search. All positions are
+ * searched to the given depth with 1, 2, 4, ... up to maxthreads threads,
+ * with the hash table cleared before each position.
+ */
+void Bench::bench_smp(Search * search, HashTable * hashtable,
+		unsigned int maxthreads, unsigned int depth)
+{
+	ASSERT(search != NULL);
+
+	printf("Running SMP scaling benchmark (depth %u)...\n", depth);
+	log("bench smp\n");
+
+	const unsigned int old_threads = search->get_threads();
+	const unsigned int old_depth = search->get_depthlimit();
+	search->set_depthlimit(depth);
+
+	unsigned int csecs1 = 0;
+	printf("Threads      Time  Speedup  Efficiency         Nodes"
+			"   knodes/s\n");
+	for (unsigned int n = 1; n <= maxthreads; ) {
+		search->set_threads(n);
+
+		unsigned long nodes = 0;
+		unsigned int csecs = 0;
+		for (unsigned int i=0; i<nr_search_fens; i++) {
+			const char * fen = fens[i];
+			if (verbose >= 2) {
+				printf("\tPosition: %s\n", fen);
+			}
+
+			Board board(fen);
+			if (hashtable) {
+				hashtable->clear();
+			}
+
+			Clock clock;
+			clock.start();
+			search->start(board, Clock(), Search::ANALYZE);
+			csecs += clock.stop();
+			nodes += search->get_nodes();
+		}
+
+		if (n == 1) {
+			csecs1 = csecs;
+		}
+		float secs = (float) csecs / 100;
+		float speedup = (csecs > 0) ? (float) csecs1 / csecs : 0;
+		float efficiency = speedup / n;
+		float knps = (csecs > 0) ? nodes / secs / 1000 : 0;
+		printf("%7u  %8.2f  %7.2f  %9.0f%%  %12lu  %9.0f\n",
+				n, secs, speedup, 100 * efficiency, nodes, knps);
+		log("threads=%u, time=%.2f, speedup=%.2f, efficiency=%.2f,"
+				" nodes=%lu\n", n, secs, speedup, efficiency,
+				nodes);
+
+		if (n < maxthreads && 2 * n > maxthreads) {
+			n = maxthreads;
+		} else {
+			n *= 2;
+		}
+	}
+
+	search->set_threads(old_threads);
+	search->set_depthlimit(old_depth);
+	log("bench smp finished\n");
+}
+
+/*
+ * Compare the speed of PGN::parse() and PGNReader on a PGN file. Both
+ * parse all games and resolve all moves.
+ */
+void Bench::bench_pgn(const char * filename)
+{
+	printf("Running PGN benchmark on %s...\n", filename);
+	log("bench pgn %s\n", filename);
+
+	FILE * fp = fopen(filename, "r");
+	if (!fp) {
+		printf("Cannot open %s for reading: %s\n", filename,
+				strerror(errno));
+		return;
+	}
+
+	Clock clock;
+	clock.start();
+	unsigned long games1 = 0, moves1 = 0;
+	while (!feof(fp)) {
+		PGN pgn;
+		if (pgn.parse(fp)) {
+			games1++;
+			moves1 += pgn.get_moves().size();
+		}
+	}
+	unsigned int csecs1 = clock.stop();
+	fclose(fp);
+
+	PGNReader reader;
+	if (!reader.open(filename)) {
+		return;
+	}
+
+	clock.start();
+	unsigned long games2 = 0, moves2 = 0;
+	PGNReader::status st;
+	while ((st = reader.next()) != PGNReader::NO_MORE_GAMES) {
+		if (st == PGNReader::GAME_OK) {
+			games2++;
+			moves2 += reader.get_moves().size();
+		}
+	}
+	unsigned int csecs2 = clock.stop();
+
+	float secs1 = (float) csecs1 / 100;
+	float secs2 = (float) csecs2 / 100;
+	printf("PGN::parse(): %lu games, %lu moves in %.2f s",
+			games1, moves1, secs1);
+	if (csecs1 > 0) {
+		printf(" (%.0f games/s)", games1 / secs1);
+	}
+	printf("\n");
+	printf("PGNReader:    %lu games, %lu moves in %.2f s",
+			games2, moves2, secs2);
+	if (csecs2 > 0) {
+		printf(" (%.0f games/s)", games2 / secs2);
+	}
+	printf("\n");
+	if (csecs1 > 0 && csecs2 > 0) {
+		printf("Speedup: %.1f\n", secs1 / secs2);
+	}
+
+	log("pgn: games=%lu/%lu, moves=%lu/%lu, time=%.2f/%.2f\n",
+			games1, games2, moves1, moves2, secs1, secs2);
+	log("bench pgn finished\n");
+}
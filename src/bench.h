@@ -25,6 +25,8 @@
 
 #include "common.h"
 #include "board.h"
+#include "hash.h"
+#include "search.h"
 
 class Bench
 {
@@ -33,6 +35,7 @@ class Bench
 		
       private:
 	static const char * fens[];	 
+	static const unsigned int nr_search_fens;
 
       public:
 	Bench();
@@ -42,6 +45,10 @@ class Bench
 	void bench_movegen();
 	void bench_evaluator();
 	void bench_makemove();
+	void bench_search(Search * search, unsigned int depth);
+	void bench_smp(Search * search, HashTable * hashtable,
+			unsigned int maxthreads, unsigned int depth);
+	void bench_pgn(const char * filename);
 
       private:
 	unsigned int bench_movegen(movegen_t movgen, const char * movegen_name);
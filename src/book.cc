@@ -23,15 +23,18 @@
 
 #include "common.h"
 #include "book.h"
-#include "pgn.h"
+#include "bookbuild.h"
 
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
 #include <algorithm>
-#include <fstream>
-#include <map>
 #include <list>
 #include <vector>
 
@@ -93,18 +96,22 @@ BookEntry::BookEntry()
 }
 
 /*
- * Create a BookEntry from the type of vector that is returned by
- * Book::group_moves().
+ * Create a BookEntry from a vector of moves and their number of
+ * occurrencies, sorted descendingly by the number of occurrencies (see
+ * BookBuilder::put_position()).
  */
 BookEntry::BookEntry(Hashkey _hashkey,
 		std::vector<std::pair<Move, unsigned int> > moves)
 {
 	hashkey = _hashkey;
 	for (unsigned int i=0; i<NR_MOVES; i++) {
-		if (i >= moves.size())
-			break;
-		move[i] = moves[i].first;
-		count[i] = moves[i].second;
+		if (i < moves.size()) {
+			move[i] = moves[i].first;
+			count[i] = moves[i].second;
+		} else {
+			move[i] = NO_MOVE;
+			count[i] = 0;
+		}
 	}
 }
 
@@ -250,6 +257,9 @@ void BookEntry::print(const Board & board) const
  */
 Book::Book(const char * filename)
 {
+	mapping = NULL;
+	mapping_size = 0;
+
 	fp = fopen(filename, "rb");
 	if (!fp) {
 		std::string msg = strprintf("Cannot open %s for reading: %s\n",
@@ -277,6 +287,12 @@ Book::Book(const char * filename)
 			throw BookException(msg);
 		}
 	}
+
+	/* If mapping fails, continue with stdio access. */
+	if (map_file()) {
+		fclose(fp);
+		fp = NULL;
+	}
 }
 
 /*
@@ -285,6 +301,9 @@ Book::Book(const char * filename)
  */
 Book::Book(const char * filename, unsigned long size)
 {
+	mapping = NULL;
+	mapping_size = 0;
+
 	fp = fopen(filename, "w+b");
 	if (!fp) {
 		fprintf(stderr, "Cannot open %s for writing: %s\n",
@@ -305,7 +324,14 @@ Book::Book(const char * filename, unsigned long size)
 
 Book::~Book()
 {
-	fclose(fp);
+#ifdef HAVE_MMAP
+	if (mapping) {
+		munmap((void *) mapping, mapping_size);
+	}
+#endif
+	if (fp) {
+		fclose(fp);
+	}
 }
 
 /*
@@ -319,6 +345,17 @@ bool Book::lookup(const Board & board, BookEntry * entry) const
 	for (unsigned int i=0; i<header.size; i++) {
 		slot = hashfunc(hashkey, i);
 
+		/* When the book is mapped, look at the hash key first and
+		 * convert the whole entry only if it matches, or if the
+		 * slot may be empty. */
+		if (mapping) {
+			Hashkey k = read_hashkey(slot);
+			if (k != hashkey && k != NULLHASHKEY) {
+				/* Collision */
+				continue;
+			}
+		}
+
 		*entry = read_entry(slot);
 		if (entry->is_empty()) {
 			/* Slot is totally empty */
@@ -386,196 +423,15 @@ unsigned long Book::hashfunc(Hashkey hashkey, unsigned int i) const
 }
 
 /*
- * Read a PGN game database and create a new opening book from the first
- * `depth' moves of each game.
+ * Create the opening book bookfile from the games in pgnfile. See class
+ * BookBuilder for how this is done. Returns false if that fails.
  */
-void Book::create_from_pgn(const char * bookfile, const char * pgnfile,
-		unsigned int depth, unsigned int min_move_count)
+bool Book::create_from_pgn(const char * bookfile, const char * pgnfile,
+		unsigned int depth, unsigned int min_move_count,
+		unsigned int threads, unsigned long memsize)
 {
-	FILE * fp = fopen(pgnfile, "r");
-	if (!fp) {
-		fprintf(stderr, "Cannot open %s for reading: %s\n",
-			pgnfile, strerror(errno));
-		exit(EXIT_FAILURE);
-	}
-	
-	
-	/*
-	 * Read all games from PGN file. Create a map with a position's
-	 * hash key and a list of moves played in this position.
-	 *
-	 * TODO This is very slow.
-	 */
-	std::map<Hashkey, std::list<Move> > pgnmap;
-	unsigned long read = 0, skipped = 0;
-
-	while (!feof(fp)) {
-		PGN pgn;
-		if (pgn.parse(fp)) {
-			Board board = pgn.get_opening();
-			std::list<Move> moves = pgn.get_moves();
-			unsigned int i = 0;
-			for (std::list<Move>::iterator it = moves.begin();
-					it != moves.end();
-					it++) {
-				ASSERT(it->is_valid(board));
-				ASSERT(it->is_legal(board));
-				pgnmap[board.get_hashkey()].push_back(*it);
-				
-				i++;
-				if (i > depth && depth > 0)
-					break;
-				
-				board.make_move(*it);
-			}
-
-			read++;
-		} else {
-			skipped++;
-		}
-
-		if ((read+skipped) % 231 == 0) {
-			printf("Reading games: %lu games read, "
-					"%lu games skipped due to errors\r",
-					read, skipped);
-			fflush(stdout);
-		}
-	}
-
-	fclose(fp);
-	
-	printf("Reading games: %lu games read, "
-			"%lu games skipped due to errors\n",
-			read, skipped);
-
-	printf("Total number of different positions in games: %lu\n",
-			(unsigned long) pgnmap.size());
-
-
-	/*
-	 * Create a BookEntry for each position stored in
-	 * the map, and store all book entries in a list.
-	 */
-
-	/* Statistics about average number of moves per BookEntry. */
-	unsigned long stat_mpe_sum = 0, stat_mpe_cnt = 0;
-	unsigned long nr_entries = 0;
-	unsigned long nr_entries_total = pgnmap.size();
-	std::list<BookEntry> entries;
-	for (std::map<Hashkey, std::list<Move> >::iterator it = pgnmap.begin();
-			it != pgnmap.end();
-			it++) {
-		BookEntry entry(it->first, group_moves(it->second,
-					min_move_count));
-		if (!entry.is_empty()) {
-			entries.push_back(entry);
-			stat_mpe_sum += entry.nr_moves();
-			stat_mpe_cnt++;
-		}
-		nr_entries++;
-
-		if (nr_entries % 500 == 0 || nr_entries == nr_entries_total) {
-			printf("Sorting and filtering book contents: %lu%%\r",
-					nr_entries * 100 / nr_entries_total);
-			fflush(stdout);
-		}
-	}
-	printf("\n");
-	
-	float stat_mpe_avg = (stat_mpe_cnt != 0) ?
-		((float) stat_mpe_sum / stat_mpe_cnt) : ((float) 0);
-	printf("Average number of moves per position: %.2f\n", stat_mpe_avg);
-
-	
-	/*
-	 * Write book to file.
-	 */
-	
-	unsigned long booksize = entries.size();
-	printf("Opening book will contain %lu positions.\n", booksize);
-
-	/* Add some extra space to reduce hash collisions */
-	unsigned long ext_booksize = (unsigned long) (booksize * 1.1);
-	
-	printf("Creating opening book with %lu entries.\n", ext_booksize);
-	Book book(bookfile, ext_booksize);
-	
-	unsigned long written = 0, collisions = 0;
-	for (std::list<BookEntry>::iterator it = entries.begin();
-			it != entries.end();
-			it++) {
-		if (book.put(*it)) {
-			written++;
-		} else {
-			collisions++;
-		}
-		
-		unsigned long total = written + collisions;
-		if (total % 500 == 0 || total == booksize) {
-			printf("Writing book to file: %lu%%\r",
-					total * 100 / booksize);
-			fflush(stdout);
-		}
-	}
-	printf("\n");
-	
-	printf("%lu entries written, %lu irresolvable collisions\n",
-			written, collisions);
-}
-		
-
-/*
- * Helper class needed by group_moves() to define a
- * strict weak ordering of std::pair<Move, int>.
- */
-class cannot_imagine_a_name_for_this_class {
-      public:
-	inline bool operator()(const std::pair<Move, unsigned int> & a,
-			const std::pair<Move, unsigned int> & b) const
-	{
-		return a.second > b.second;
-	}
-};
-
-/*
- * Take a list of moves and create a vector of all distinct moves together
- * with their total number of occurrencies in the list. The returned vector
- * will be sorted descendingly by the number of occurrencies. However, only
- * moves that appeared at least min_move_count times are kept.
- * We do this because we want to have only the most frequently played moves
- * in the opening book.
- */
-std::vector<std::pair<Move, unsigned int> > Book::group_moves(
-		std::list<Move> moves,
-		unsigned int min_move_count)
-{
-	/* Count total number of occurrencies of each move. */
-	std::map<Move, unsigned int, Move::strict_weak_ordering> count;
-	for (std::list<Move>::iterator it = moves.begin(); 
-			it != moves.end();
-			it++) {
-		count[*it]++;
-	}
-	
-	/* Put entries of map into vector. */
-	std::vector<std::pair<Move, unsigned int> > ret;
-	for (std::map<Move, unsigned int, Move::strict_weak_ordering>::iterator
-							it2 = count.begin();
-			it2 != count.end();
-			it2++) {
-		Move mov = it2->first;
-		unsigned int cnt = it2->second;
-
-		/* Keep only frequently played moves. */
-		if (cnt >= min_move_count) {
-			ret.push_back(std::pair<Move, unsigned int>(mov, cnt));
-		}
-	}
-
-	cannot_imagine_a_name_for_this_class lt;
-	std::sort(ret.begin(), ret.end(), lt);
-
-	return ret;
+	BookBuilder builder(pgnfile, depth, min_move_count, threads, memsize);
+	return builder.build(bookfile);
 }
 
 
@@ -612,6 +468,54 @@ void Book::write_header()
 	}
 }
 
+/*
+ * Map the whole book file into memory, read-only. The pages are shared
+ * with all other processes that use the same book.
+ */
+bool Book::map_file()
+{
+#ifdef HAVE_MMAP
+	struct stat st;
+	if (fstat(fileno(fp), &st) == -1) {
+		return false;
+	}
+
+	const size_t size = sizeof(BookHeader)
+		+ (size_t) header.size * sizeof(BookEntry);
+	if ((size_t) st.st_size < size) {
+		return false;
+	}
+
+	void * p = mmap(NULL, size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+
+	/* Book probes do not access the file sequentially. */
+	madvise(p, size, MADV_RANDOM);
+
+	mapping = (const char *) p;
+	mapping_size = size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+Hashkey Book::read_hashkey(unsigned long slot) const
+{
+	ASSERT(mapping != NULL);
+	if (slot >= header.size) {
+		BUG("Slot is beyond end of book: slot = %d, size = %d",
+				slot, header.size);
+	}
+
+	Hashkey hashkey;
+	memcpy(&hashkey, mapping + sizeof(BookHeader)
+			+ slot * sizeof(BookEntry), sizeof(Hashkey));
+	return swap_byteorder ? reverse_byte_order(hashkey) : hashkey;
+}
+
 BookEntry Book::read_entry(unsigned long slot) const
 {
 	if (slot >= header.size) {
@@ -620,12 +524,18 @@ BookEntry Book::read_entry(unsigned long slot) const
 	}
 	
 	unsigned long pos = sizeof(BookHeader) + slot * sizeof(BookEntry);
+
+	BookEntry tmp_entry;
+	if (mapping) {
+		memcpy((void *) &tmp_entry, mapping + pos, sizeof(BookEntry));
+		return BookEntry::b2h(tmp_entry, swap_byteorder);
+	}
+
 	if (fseek(fp, pos, SEEK_SET) == -1) {
 		perror("Book::read_entry(): fseek() failed");
 		exit(EXIT_FAILURE);
 	}
 	
-	BookEntry tmp_entry;
 	if (fread(&tmp_entry, sizeof(BookEntry), 1, fp) != 1) {
 		perror("Book::read_entry(): fread() failed");
 		exit(EXIT_FAILURE);
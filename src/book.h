@@ -115,6 +115,11 @@ class Book {
 	FILE * fp;
 	bool swap_byteorder;
 	BookHeader header;
+
+	/* If the book was opened read-only, it is mapped into memory if
+	 * possible, and fp is closed. */
+	const char * mapping;
+	size_t mapping_size;
 	
       public:
 	Book(const char * filename);
@@ -125,17 +130,19 @@ class Book {
 	bool lookup(const Board & board, BookEntry * entry) const;
 	bool put(const BookEntry & entry);
 
-	static void create_from_pgn(const char * bookfile,
+	static bool create_from_pgn(const char * bookfile,
 			const char * pgnfile,
 			unsigned int depth,
-			unsigned int min_move_count);
+			unsigned int min_move_count,
+			unsigned int threads,
+			unsigned long memsize);
 
       private:
 	unsigned long hashfunc(Hashkey hashkey, unsigned int i) const;
-	static std::vector<std::pair<Move, unsigned int> > group_moves(
-			std::list<Move> moves, unsigned int min_move_count);
 	void read_header();
 	void write_header();
+	bool map_file();
+	Hashkey read_hashkey(unsigned long slot) const;
 	BookEntry read_entry(unsigned long slot) const;
 	void write_entry(unsigned long slot, const BookEntry & entry);
 };
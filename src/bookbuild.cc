@@ -0,0 +1,527 @@
+/* $Id$
+ *
+ * HoiChess/bookbuild.cc
+ *
+ * Copyright (C) 2005-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "bookbuild.h"
+
+#include "clock.h"
+#include "pgn.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <queue>
+
+
+/*
+ * Create a book builder. depth and min_move_count have the same meaning
+ * as for Book::create_from_pgn(). threads is the number of threads that
+ * parse the PGN file, memsize the memory budget in bytes for the record
+ * buffers.
+ */
+BookBuilder::BookBuilder(const char * pgnfile, unsigned int depth,
+		unsigned int min_move_count, unsigned int threads,
+		unsigned long memsize)
+{
+	this->pgnfile = pgnfile;
+	this->depth = depth;
+	this->min_move_count = min_move_count;
+	this->nr_threads = (threads > 0) ? threads : 1;
+	this->memsize = memsize;
+
+	next_chunk = 0;
+	games_read = 0;
+	games_skipped = 0;
+	records_spilled = 0;
+
+	nr_positions = 0;
+	nr_entries = 0;
+	stat_mpe_sum = 0;
+}
+
+BookBuilder::~BookBuilder()
+{
+	for (unsigned int i = 0; i < runs.size(); i++) {
+		fclose(runs[i]);
+	}
+}
+
+/*
+ * Create the opening book bookfile from the PGN file.
+ */
+bool BookBuilder::build(const char * bookfile)
+{
+	Clock clock;
+	clock.start();
+
+	/*
+	 * Find the games in the PGN file, and parse them in parallel.
+	 */
+	if (!scan_chunks()) {
+		return false;
+	}
+
+	if (nr_threads == 1 || chunks.size() <= 1) {
+		parse_chunks();
+	} else {
+		std::vector<Thread *> threads;
+		for (unsigned int i = 0; i < nr_threads; i++) {
+			Thread * thread = new Thread(thread_main);
+			thread->start(this);
+			threads.push_back(thread);
+		}
+		for (unsigned int i = 0; i < threads.size(); i++) {
+			threads[i]->wait();
+			delete threads[i];
+		}
+	}
+	print_progress(true);
+
+	printf("%lu records in %u runs\n", records_spilled,
+			(unsigned int) runs.size());
+
+	/*
+	 * Merge the runs. If there are too many of them to be merged at
+	 * once, merge groups of them into larger runs first.
+	 */
+	while (runs.size() > MERGE_WAYS) {
+		std::vector<FILE *> merged;
+		for (unsigned int i = 0; i < runs.size(); i += MERGE_WAYS) {
+			std::vector<FILE *> group(runs.begin() + i,
+					runs.begin() + MIN(i + MERGE_WAYS,
+						runs.size()));
+			merged.push_back(merge(group, NULL));
+		}
+		runs = merged;
+	}
+
+	FILE * entries = tmpfile();
+	if (!entries) {
+		perror("BookBuilder::build(): tmpfile() failed");
+		return false;
+	}
+	merge(runs, entries);
+	runs.clear();
+
+	printf("Total number of different positions in games: %lu\n",
+			nr_positions);
+	float stat_mpe_avg = (nr_entries != 0) ?
+		((float) stat_mpe_sum / nr_entries) : ((float) 0);
+	printf("Average number of moves per position: %.2f\n", stat_mpe_avg);
+
+	/*
+	 * Write book to file.
+	 */
+	unsigned long booksize = nr_entries;
+	printf("Opening book will contain %lu positions.\n", booksize);
+
+	/* Add some extra space to reduce hash collisions */
+	unsigned long ext_booksize = (unsigned long) (booksize * 1.1);
+
+	printf("Creating opening book with %lu entries.\n", ext_booksize);
+	Book book(bookfile, ext_booksize);
+
+	rewind(entries);
+	std::vector<BookEntry> buf(4096);
+	unsigned long written = 0, collisions = 0;
+	size_t n;
+	while ((n = fread(&buf[0], sizeof(BookEntry), buf.size(), entries))
+			> 0) {
+		for (size_t i = 0; i < n; i++) {
+			if (book.put(buf[i])) {
+				written++;
+			} else {
+				collisions++;
+			}
+
+			unsigned long total = written + collisions;
+			if (total % 500 == 0 || total == booksize) {
+				printf("Writing book to file: %lu%%\r",
+						total * 100 / booksize);
+				fflush(stdout);
+			}
+		}
+	}
+	printf("\n");
+	fclose(entries);
+
+	printf("%lu entries written, %lu irresolvable collisions\n",
+			written, collisions);
+
+	clock.stop();
+	float secs = (float) clock.get_elapsed_time() / 100;
+	printf("Book created in %.2f s", secs);
+	if (secs > 0) {
+		printf(", %.0f games/s", (games_read + games_skipped) / secs);
+	}
+	printf("\n");
+
+	return true;
+}
+
+/*
+ * Split the PGN file into chunks of CHUNK_GAMES games each. A game starts
+ * with the first of a sequence of tag lines. This only reads lines, so it
+ * is much faster than parsing, and lets the threads start at known game
+ * boundaries.
+ */
+bool BookBuilder::scan_chunks()
+{
+	FILE * fp = fopen(pgnfile, "rb");
+	if (!fp) {
+		fprintf(stderr, "Cannot open %s for reading: %s\n",
+			pgnfile, strerror(errno));
+		return false;
+	}
+
+	char buf[4096];
+	long offset = 0;
+	bool line_start = true;
+	bool in_tags = false;
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+		size_t len = strlen(buf);
+		if (line_start) {
+			bool tag = (buf[0] == '[');
+			if (tag && !in_tags) {
+				if (chunks.empty() || chunks.back().nr_games
+						== CHUNK_GAMES) {
+					chunk c;
+					c.offset = offset;
+					c.nr_games = 0;
+					chunks.push_back(c);
+				}
+				chunks.back().nr_games++;
+			}
+			in_tags = tag;
+		}
+		line_start = (len > 0 && buf[len-1] == '\n');
+		offset += len;
+	}
+
+	fclose(fp);
+	return true;
+}
+
+/*
+ * Take chunks from the shared list and parse their games, until all chunks
+ * are done. Each book move becomes a record, and full record buffers are
+ * spilled to runs.
+ */
+void BookBuilder::parse_chunks()
+{
+	PGNReader reader;
+	if (!reader.open(pgnfile)) {
+		return;
+	}
+
+	std::vector<record> buf;
+	size_t bufsize = MAX(memsize / nr_threads / sizeof(record), 1024UL);
+	buf.reserve(bufsize);
+
+	for (;;) {
+		mutex.lock();
+		if (next_chunk == chunks.size()) {
+			mutex.unlock();
+			break;
+		}
+		chunk c = chunks[next_chunk++];
+		mutex.unlock();
+
+		if (!reader.seek(c.offset)) {
+			fprintf(stderr, "BookBuilder::parse_chunks():"
+					" cannot seek to %ld\n", c.offset);
+			break;
+		}
+
+		unsigned long read = 0, skipped = 0;
+		for (unsigned int g = 0; g < c.nr_games; g++) {
+			PGNReader::status st = reader.next();
+			if (st == PGNReader::NO_MORE_GAMES) {
+				break;
+			} else if (st == PGNReader::GAME_BAD) {
+				skipped++;
+				continue;
+			}
+
+			Board board = reader.get_opening();
+			const std::vector<Move> & moves = reader.get_moves();
+			for (unsigned int i = 0; i < moves.size(); i++) {
+				ASSERT(moves[i].is_valid(board));
+				ASSERT(moves[i].is_legal(board));
+				record r;
+				r.hashkey = board.get_hashkey();
+				r.move = moves[i];
+				r.count = 1;
+				buf.push_back(r);
+				if (buf.size() == bufsize) {
+					spill(buf);
+				}
+
+				if (i + 1 > depth && depth > 0)
+					break;
+
+				board.make_move(moves[i]);
+			}
+
+			read++;
+		}
+
+		mutex.lock();
+		games_read += read;
+		games_skipped += skipped;
+		print_progress(false);
+		mutex.unlock();
+	}
+
+	spill(buf);
+}
+
+void * BookBuilder::thread_main(void * arg)
+{
+	BookBuilder * builder = (BookBuilder *) arg;
+	builder->parse_chunks();
+	return NULL;
+}
+
+/*
+ * Sort a record buffer, count equal records, write the result to a new
+ * run, and empty the buffer.
+ */
+void BookBuilder::spill(std::vector<record> & buf)
+{
+	if (buf.empty()) {
+		return;
+	}
+
+	std::sort(buf.begin(), buf.end());
+
+	size_t n = 0;
+	for (size_t i = 0; i < buf.size(); i++) {
+		if (n > 0 && buf[n-1].hashkey == buf[i].hashkey
+				&& buf[n-1].move == buf[i].move) {
+			buf[n-1].count += buf[i].count;
+		} else {
+			buf[n++] = buf[i];
+		}
+	}
+
+	FILE * fp = tmpfile();
+	if (!fp) {
+		perror("BookBuilder::spill(): tmpfile() failed");
+		exit(EXIT_FAILURE);
+	}
+	if (fwrite(&buf[0], sizeof(record), n, fp) != n) {
+		perror("BookBuilder::spill(): fwrite() failed");
+		exit(EXIT_FAILURE);
+	}
+
+	mutex.lock();
+	runs.push_back(fp);
+	records_spilled += n;
+	mutex.unlock();
+
+	buf.clear();
+}
+
+bool BookBuilder::runreader::next(record * r)
+{
+	if (pos == len) {
+		len = fread(&buf[0], sizeof(record), buf.size(), fp);
+		pos = 0;
+		if (len == 0) {
+			return false;
+		}
+	}
+
+	*r = buf[pos++];
+	return true;
+}
+
+/*
+ * Merge the runs in, and close them. If entries is NULL, the merged
+ * records are written to a new run, which is returned. Otherwise, the
+ * moves of each position are turned into a book entry, and the entries
+ * are written to the file entries.
+ */
+FILE * BookBuilder::merge(std::vector<FILE *> & in, FILE * entries)
+{
+	size_t bufsize = MAX(memsize / (in.size() + 1) / sizeof(record),
+			256UL);
+
+	std::vector<runreader> readers(in.size());
+	std::priority_queue<heapitem> heap;
+	for (unsigned int i = 0; i < in.size(); i++) {
+		rewind(in[i]);
+		readers[i].fp = in[i];
+		readers[i].buf.resize(bufsize);
+		readers[i].pos = readers[i].len = 0;
+
+		heapitem h;
+		h.run = i;
+		if (readers[i].next(&h.r)) {
+			heap.push(h);
+		}
+	}
+
+	FILE * out = entries;
+	if (!out) {
+		out = tmpfile();
+		if (!out) {
+			perror("BookBuilder::merge(): tmpfile() failed");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	std::vector<record> outbuf;
+	outbuf.reserve(bufsize);
+	std::vector<std::pair<Move, unsigned int> > moves;
+	Hashkey moves_hashkey = NULLHASHKEY;
+
+	record cur;
+	bool have_cur = false;
+	for (;;) {
+		bool done = heap.empty();
+		heapitem h;
+		if (!done) {
+			h = heap.top();
+			heap.pop();
+
+			heapitem h2;
+			h2.run = h.run;
+			if (readers[h.run].next(&h2.r)) {
+				heap.push(h2);
+			}
+
+			if (have_cur && cur.hashkey == h.r.hashkey
+					&& cur.move == h.r.move) {
+				cur.count += h.r.count;
+				continue;
+			}
+		}
+
+		if (have_cur) {
+			if (entries) {
+				if (!moves.empty()
+						&& moves_hashkey != cur.hashkey) {
+					put_position(moves_hashkey, moves,
+							entries);
+				}
+				moves_hashkey = cur.hashkey;
+				moves.push_back(std::pair<Move, unsigned int>(
+							cur.move, cur.count));
+			} else {
+				outbuf.push_back(cur);
+				if (outbuf.size() == bufsize) {
+					fwrite(&outbuf[0], sizeof(record),
+							outbuf.size(), out);
+					outbuf.clear();
+				}
+			}
+		}
+
+		if (done) {
+			break;
+		}
+		cur = h.r;
+		have_cur = true;
+	}
+
+	if (!moves.empty()) {
+		put_position(moves_hashkey, moves, entries);
+	}
+	if (!outbuf.empty()) {
+		fwrite(&outbuf[0], sizeof(record), outbuf.size(), out);
+	}
+	if (ferror(out)) {
+		perror("BookBuilder::merge(): fwrite() failed");
+		exit(EXIT_FAILURE);
+	}
+
+	for (unsigned int i = 0; i < in.size(); i++) {
+		fclose(in[i]);
+	}
+	in.clear();
+
+	return out;
+}
+
+/*
+ * Helper class needed by put_position() to sort the moves of a position
+ * descendingly by the number of occurrencies.
+ */
+class more_frequent_move {
+      public:
+	inline bool operator()(const std::pair<Move, unsigned int> & a,
+			const std::pair<Move, unsigned int> & b) const
+	{
+		return a.second > b.second;
+	}
+};
+
+/*
+ * Create a BookEntry from all distinct moves played in a position, and
+ * write it to entries. Only moves that appeared at least min_move_count
+ * times are kept, because we want to have only the most frequently played
+ * moves in the opening book. The moves vector is emptied.
+ */
+void BookBuilder::put_position(Hashkey hashkey,
+		std::vector<std::pair<Move, unsigned int> > & moves,
+		FILE * entries)
+{
+	nr_positions++;
+
+	size_t n = 0;
+	for (size_t i = 0; i < moves.size(); i++) {
+		if (moves[i].second >= min_move_count) {
+			moves[n++] = moves[i];
+		}
+	}
+	moves.resize(n);
+	std::stable_sort(moves.begin(), moves.end(), more_frequent_move());
+
+	BookEntry entry(hashkey, moves);
+	if (!entry.is_empty()) {
+		if (fwrite(&entry, sizeof(BookEntry), 1, entries) != 1) {
+			perror("BookBuilder::put_position(): fwrite() failed");
+			exit(EXIT_FAILURE);
+		}
+		stat_mpe_sum += entry.nr_moves();
+		nr_entries++;
+	}
+
+	moves.clear();
+}
+
+/*
+ * Print the number of games parsed so far. Must be called with mutex
+ * held, or after all threads are finished.
+ */
+void BookBuilder::print_progress(bool final)
+{
+	printf("Reading games: %lu games read, "
+			"%lu games skipped due to errors%c",
+			games_read, games_skipped, final ? '\n' : '\r');
+	fflush(stdout);
+}
@@ -0,0 +1,143 @@
+/* $Id$
+ *
+ * HoiChess/bookbuild.h
+ *
+ * Copyright (C) 2005-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef BOOKBUILD_H
+#define BOOKBUILD_H
+
+#include "common.h"
+#include "book.h"
+#include "hash.h"
+#include "move.h"
+#include "thread.h"
+
+#include <stdio.h>
+
+#include <vector>
+
+/*****************************************************************************
+ *
+ * Class BookBuilder
+ *
+ * Create an opening book from a PGN file. The games are parsed in parallel,
+ * each thread emitting one (hashkey, move) record per book move. When a
+ * thread's record buffer is full, it is sorted, equal records are counted,
+ * and the result is spilled to a temporary file (a "run"). The runs are
+ * then merged, which yields all moves played in a position in one go,
+ * so that the book entries can be created without keeping all positions
+ * in memory. Memory use is bounded by the given budget (plus one chunk
+ * descriptor per 1024 games).
+ *
+ *****************************************************************************/
+
+class BookBuilder
+{
+      private:
+	/* A move played in a position, with the number of times it was
+	 * played. Runs are sorted by hash key and move. */
+	struct record {
+		Hashkey hashkey;
+		Move move;
+		uint32_t count;
+
+		bool operator<(const record & r) const {
+			return hashkey < r.hashkey
+				|| (hashkey == r.hashkey && move < r.move);
+		}
+	};
+
+	/* A piece of the PGN file that starts at a game and contains
+	 * the given number of games. */
+	struct chunk {
+		long offset;
+		unsigned int nr_games;
+	};
+
+	/* Buffered reader for one run during merging. */
+	struct runreader {
+		FILE * fp;
+		std::vector<record> buf;
+		size_t pos;
+		size_t len;
+
+		bool next(record * r);
+	};
+
+	/* Head of a run in the merge heap. The ordering is reversed, so
+	 * that std::priority_queue returns the smallest record first. */
+	struct heapitem {
+		record r;
+		unsigned int run;
+
+		bool operator<(const heapitem & h) const {
+			return h.r < r;
+		}
+	};
+
+	/* Number of games in a chunk. */
+	static const unsigned int CHUNK_GAMES = 1024;
+
+	/* Maximum number of runs merged at the same time. */
+	static const unsigned int MERGE_WAYS = 64;
+
+      private:
+	const char * pgnfile;
+	unsigned int depth;
+	unsigned int min_move_count;
+	unsigned int nr_threads;
+	unsigned long memsize;
+
+	/* Shared by all threads, protected by mutex. */
+	std::vector<chunk> chunks;
+	unsigned int next_chunk;
+	std::vector<FILE *> runs;
+	unsigned long games_read;
+	unsigned long games_skipped;
+	unsigned long records_spilled;
+	Mutex mutex;
+
+	/* Statistics of the final merge. */
+	unsigned long nr_positions;
+	unsigned long nr_entries;
+	unsigned long stat_mpe_sum;
+
+      public:
+	BookBuilder(const char * pgnfile, unsigned int depth,
+			unsigned int min_move_count, unsigned int threads,
+			unsigned long memsize);
+	~BookBuilder();
+
+      public:
+	bool build(const char * bookfile);
+
+      private:
+	bool scan_chunks();
+	void parse_chunks();
+	static void * thread_main(void * arg);
+	void spill(std::vector<record> & buf);
+	FILE * merge(std::vector<FILE *> & in, FILE * entries);
+	void put_position(Hashkey hashkey,
+			std::vector<std::pair<Move, unsigned int> > & moves,
+			FILE * entries);
+	void print_progress(bool final);
+};
+
+#endif // BOOKBUILD_H
@@ -9,9 +9,10 @@ EOF
 grep -E '^(//)? *# *define' config.h | grep -v 'CONFIG_H'	\
 | sed -r -e 's/^(\/\/)? *# *define +(.*)$/\2/'	\
 | while read param rest; do
-	echo "#ifdef $param"
-	echo "	std::cout << \"\t$param \" << EXPTOSTRING($param) << \"\n\";"
-	echo "#endif"
+	printf '#ifdef %s\n' "$param"
+	printf '\tstd::cout << "\\t%s " << EXPTOSTRING(%s) << "\\n";\n' \
+		"$param" "$param"
+	printf '#endif\n'
 done
 
 cat << EOF
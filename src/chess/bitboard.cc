@@ -24,6 +24,12 @@
 #include "common.h"
 #include "bitboard.h"
 
+#include <string.h>
+
+#if defined(USE_ASM_PEXT) || defined(USE_HW_BITOPS)
+# include <cpuid.h>
+#endif
+
 
 void Bitboard::print() const
 {
@@ -62,6 +68,7 @@ void Bitboard::print2() const
 int8_t Bitboard::lsb_lut[65536];
 int8_t Bitboard::msb_lut[65536];
 int8_t Bitboard::popcnt_lut[65536];
+bool Bitboard::use_hw_bitops = false;
 
 Bitboard Bitboard::file[8];
 Bitboard Bitboard::rank[8];
@@ -108,6 +115,8 @@ void Bitboard::init()
 		}		
 	}
 	
+	use_hw_bitops = have_hw_bitops();
+	
 	/* file bitboards */
 	for (int f=0; f<8; f++) {
 		file[f] = NULLBITBOARD;
@@ -128,7 +137,9 @@ void Bitboard::init()
 	init_pawn_capt_bb();
 	init_ray_bb();
 	init_masks();
-	init_rot_atk();
+
+	use_pext = have_pext();
+	init_sliders();
 }
 
 
@@ -396,238 +407,272 @@ void Bitboard::init_masks()
 
 /*****************************************************************************
  *
- * Stuff needed for rotated bitboards.
+ * Magic bitboards.
  *
  *****************************************************************************/
 
-const int Bitboard::shift_0[] = {
-	 0,  0,  0,  0,  0,  0,  0,  0,
-	 8,  8,  8,  8,  8,  8,  8,  8,
-	16, 16, 16, 16, 16, 16, 16, 16,
-	24, 24, 24, 24, 24, 24, 24, 24,
-	32, 32, 32, 32, 32, 32, 32, 32,
-	40, 40, 40, 40, 40, 40, 40, 40,
-	48, 48, 48, 48, 48, 48, 48, 48,
-	56, 56, 56, 56, 56, 56, 56, 56
+/* Magic numbers for plain magic bitboards with a fixed shift of
+ * 64 - popcnt(mask). They were found by trial and error with
+ * random numbers with few bits set. */
+const uint64_t Bitboard::bishop_magic_numbers[64] = {
+	0x10102002004a1420ULL, 0x8020040400584008ULL,
+	0x10510800811201c8ULL, 0x5204042080000088ULL,
+	0x2204106880000002ULL, 0x1401042004000000ULL,
+	0x0400880410042004ULL, 0x0028208200a02020ULL,
+	0x1500241990010e00ULL, 0x8001200182020a40ULL,
+	0x40004101030b0000ULL, 0x8002041042000100ULL,
+	0x4010011041020038ULL, 0x0000010421044000ULL,
+	0x1500210808020a00ULL, 0x8000088400880520ULL,
+	0x0405004010040100ULL, 0x1005823210040108ULL,
+	0x2708008102040011ULL, 0x4048200404009100ULL,
+	0x0018104101400024ULL, 0x0003000601190101ULL,
+	0x8004803108491000ULL, 0x8014241200820800ULL,
+	0x0006e080100c3040ULL, 0x0501044a11041800ULL,
+	0x9020300008004045ULL, 0x0894080000220040ULL,
+	0x1001010083104000ULL, 0x5004030040900080ULL,
+	0x000400422c012400ULL, 0x0002128698404812ULL,
+	0x1010108404900440ULL, 0x0928021182084100ULL,
+	0x2006080409020024ULL, 0x1010202020180080ULL,
+	0xa010008200202200ULL, 0x2098015100019004ULL,
+	0x0002041440810811ULL, 0x802a02020000b098ULL,
+	0x0009015090004060ULL, 0x4000821082081001ULL,
+	0x0100210040420800ULL, 0x0800004010488a00ULL,
+	0x2000081104004040ULL, 0x4c8e029015000082ULL,
+	0x0420340322224842ULL, 0x1298260043400210ULL,
+	0x0000822802400008ULL, 0x00008a0101600000ULL,
+	0x3040003412080021ULL, 0x3040290220884800ULL,
+	0x4a1500401041004aULL, 0x8010200282020781ULL,
+	0x0020203142209091ULL, 0x0070300600902110ULL,
+	0x0040808800b62048ULL, 0x0000810400c44420ULL,
+	0x00080400440c0441ULL, 0x8340080020840411ULL,
+	0x0000000104208200ULL, 0x0000800810d00080ULL,
+	0x0400530411080200ULL, 0x4040702400932244ULL
 };
 
-const int Bitboard::map_l90[] = {
-	56, 48, 40, 32, 24, 16,  8,  0,
-	57, 49, 41, 33, 25, 17,  9,  1,
-	58, 50, 42, 34, 26, 18, 10,  2,
-	59, 51, 43, 35, 27, 19, 11,  3,
-	60, 52, 44, 36, 28, 20, 12,  4,
-	61, 53, 45, 37, 29, 21, 13,  5,
-	62, 54, 46, 38, 30, 22, 14,  6,
-	63, 55, 47, 39, 31, 23, 15,  7
+const uint64_t Bitboard::rook_magic_numbers[64] = {
+	0x1080004008801020ULL, 0x0840092002c03000ULL,
+	0x1900200010400900ULL, 0x0880100008000480ULL,
+	0x4200100420080200ULL, 0x8100020100080400ULL,
+	0x0200040110886200ULL, 0x0200008040220411ULL,
+	0x0404800084400220ULL, 0x0000401000402000ULL,
+	0x0086001081220440ULL, 0x0408800800100280ULL,
+	0x000a001201040820ULL, 0x8848800200840080ULL,
+	0x4001000100040200ULL, 0x0442000102105084ULL,
+	0x9080010020804100ULL, 0x0040404000201009ULL,
+	0x0000808010002009ULL, 0x2200090021d00100ULL,
+	0x0008008008040080ULL, 0x0004004002010040ULL,
+	0x0011040008015042ULL, 0x00000a0001768104ULL,
+	0x0000800080204009ULL, 0x2010004140002001ULL,
+	0x9800200280100080ULL, 0x1000100080080080ULL,
+	0x0442000a00049020ULL, 0x2100040080020080ULL,
+	0x0800120400900148ULL, 0x0010040a00128541ULL,
+	0x2800804000800030ULL, 0x1010002000400041ULL,
+	0x4000200011004100ULL, 0x0610008410800800ULL,
+	0x0400802402800800ULL, 0xc100020080800400ULL,
+	0x0002000802000401ULL, 0x0182085882000401ULL,
+	0x0220204000808000ULL, 0x2860100040024022ULL,
+	0x0001002004110040ULL, 0x99101042000a0020ULL,
+	0x0004080004008080ULL, 0x0010040002008080ULL,
+	0x2012004881020004ULL, 0x8300842444820011ULL,
+	0x0088403882010200ULL, 0x0820400080210100ULL,
+	0x0110910040a00300ULL, 0x0801100280080480ULL,
+	0x0242009008200600ULL, 0x1002000489500200ULL,
+	0x0040800200010080ULL, 0x0091800041000080ULL,
+	0x0000209300488001ULL, 0x04c1002414824001ULL,
+	0x020020000b001041ULL, 0x7000100004200901ULL,
+	0x8002002004100802ULL, 0x30010002084c0007ULL,
+	0x0888221800813004ULL, 0x4000002840840112ULL
 };
 
-const Square Bitboard::inv_map_l90[] = {
-	H1, H2, H3, H4, H5, H6, H7, H8,
-	G1, G2, G3, G4, G5, G6, G7, G8,
-	F1, F2, F3, F4, F5, F6, F7, F8,
-	E1, E2, E3, E4, E5, E6, E7, E8,
-	D1, D2, D3, D4, D5, D6, D7, D8,
-	C1, C2, C3, C4, C5, C6, C7, C8,
-	B1, B2, B3, B4, B5, B6, B7, B8,
-	A1, A2, A3, A4, A5, A6, A7, A8
-};
+struct Bitboard::magic Bitboard::bishop_magic[64];
+struct Bitboard::magic Bitboard::rook_magic[64];
+Bitboard Bitboard::bishop_atk_table[5248];
+Bitboard Bitboard::rook_atk_table[102400];
+bool Bitboard::use_pext = false;
 
-const int Bitboard::shift_l90[] = {
-	56, 48, 40, 32, 24, 16,  8,  0,
-	56, 48, 40, 32, 24, 16,  8,  0,
-	56, 48, 40, 32, 24, 16,  8,  0,
-	56, 48, 40, 32, 24, 16,  8,  0,
-	56, 48, 40, 32, 24, 16,  8,  0,
-	56, 48, 40, 32, 24, 16,  8,  0,
-	56, 48, 40, 32, 24, 16,  8,  0,
-	56, 48, 40, 32, 24, 16,  8,  0
-};
+/*
+ * Compute the attack set of a slider on square f (0x88 coordinates)
+ * moving in the given directions, for the given occupied squares.
+ * Also compute the mask of relevant occupied squares, i.e. all squares
+ * on the rays except the last one.
+ */
+static Bitboard slider_attacks(int f, const int * dirs, uint64_t occupied,
+		uint64_t * mask)
+{
+	Bitboard atk = NULLBITBOARD;
+	*mask = 0;
+
+	for (int i=0; i<4; i++) {
+		for (int t=f+dirs[i]; !(t & 0x88); t+=dirs[i]) {
+			const Square to = map0x88[t];
+			atk.setbit(to);
+			if (!((t+dirs[i]) & 0x88)) {
+				*mask |= ((uint64_t) 1) << to;
+			}
+			if (occupied & (((uint64_t) 1) << to)) {
+				break;
+			}
+		}
+	}
 
-const int Bitboard::map_l45[] = {
-	28, 21, 15, 10,  6,  3,  1,  0,
-	36, 29, 22, 16, 11,  7,  4,  2,
-	43, 37, 30, 23, 17, 12,  8,  5,
-	49, 44, 38, 31, 24, 18, 13,  9,
-	54, 50, 45, 39, 32, 25, 19, 14,
-	58, 55, 51, 46, 40, 33, 26, 20,
-	61, 59, 56, 52, 47, 41, 34, 27,
-	63, 62, 60, 57, 53, 48, 42, 35
-};
+	return atk;
+}
 
-const Square Bitboard::inv_map_l45[] = {
-			H1,
-		      G1, H2,
-		    F1, G2, H3,
-		  E1, F2, G3, H4,
-		D1, E2, F3, G4, H5,
-              C1, D2, E3, F4, G5, H6,
-	    B1, C2, D3, E4, F5, G6, H7,
-	  A1, B2, C3, D4, E5, F6, G7, H8,
-	    A2, B3, C4, D5, E6, F7, G8,
-	      A3, B4, C5, D6, E7, F8,
-	        A4, B5, C6, D7, E8,
-		  A5, B6, C7, D8,
-		    A6, B7, C8,
-		      A7, B8,
-		        A8
-};
+/*
+ * Fill the attack tables according to the selected backend, i.e. the
+ * value of use_pext. The layout of the tables differs between magic
+ * multiplication and PEXT, so they must be rebuilt when the backend
+ * is changed.
+ */
+void Bitboard::init_sliders()
+{
+	Bitboard * btable = bishop_atk_table;
+	Bitboard * rtable = rook_atk_table;
 
-const int Bitboard::shift_l45[] = {
-	28, 21, 15, 10,  6,  3,  1,  0,
-	36, 28, 21, 15, 10,  6,  3,  1,
-	43, 36, 28, 21, 15, 10,  6,  3,
-	49, 43, 36, 28, 21, 15, 10,  6,
-	54, 49, 43, 36, 28, 21, 15, 10,
-	58, 54, 49, 43, 36, 28, 21, 15,
-	61, 58, 54, 49, 43, 36, 28, 21,
-	63, 61, 58, 54, 49, 43, 36, 28
-};
+	for (int f=0; f<128; f++) {
+		if (f & 0x88)
+			continue;
 
-const int Bitboard::diaglen_l45[] = {
-	 8,  7,  6,  5,  4,  3,  2,  1,
-	 7,  8,  7,  6,  5,  4,  3,  2,
-	 6,  7,  8,  7,  6,  5,  4,  3,
-	 5,  6,  7,  8,  7,  6,  5,  4,
-	 4,  5,  6,  7,  8,  7,  6,  5,
-	 3,  4,  5,  6,  7,  8,  7,  6,
-	 2,  3,  4,  5,  6,  7,  8,  7,
-	 1,  2,  3,  4,  5,  6,  7,  8
-};
+		const Square from = map0x88[f];
+		struct magic * bm = &bishop_magic[from];
+		struct magic * rm = &rook_magic[from];
+
+		slider_attacks(f, bishop_dir0x88, 0, &bm->mask);
+		bm->table = btable;
+		bm->magic = bishop_magic_numbers[from];
+		bm->shift = 64 - Bitboard(bm->mask).popcnt();
+		btable += 1 << (64 - bm->shift);
+
+		slider_attacks(f, rook_dir0x88, 0, &rm->mask);
+		rm->table = rtable;
+		rm->magic = rook_magic_numbers[from];
+		rm->shift = 64 - Bitboard(rm->mask).popcnt();
+		rtable += 1 << (64 - rm->shift);
+
+		/* Enumerate all subsets of the masks. */
+		uint64_t mask, occ;
+
+		occ = 0;
+		do {
+			bm->table[magic_index(*bm, occ)] =
+				slider_attacks(f, bishop_dir0x88, occ, &mask);
+			occ = (occ - bm->mask) & bm->mask;
+		} while (occ);
+
+		occ = 0;
+		do {
+			rm->table[magic_index(*rm, occ)] =
+				slider_attacks(f, rook_dir0x88, occ, &mask);
+			occ = (occ - rm->mask) & rm->mask;
+		} while (occ);
+	}
 
-const int Bitboard::mask_l45[] = {
-	0xff, 0x7f, 0x3f, 0x1f, 0x0f, 0x07, 0x03, 0x01,
-	0x7f, 0xff, 0x7f, 0x3f, 0x1f, 0x0f, 0x07, 0x03,
-	0x3f, 0x7f, 0xff, 0x7f, 0x3f, 0x1f, 0x0f, 0x07,
-	0x1f, 0x3f, 0x7f, 0xff, 0x7f, 0x3f, 0x1f, 0x0f,
-	0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0x7f, 0x3f, 0x1f,
-	0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0x7f, 0x3f,
-	0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0x7f,
-	0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff
-};
+	ASSERT(btable == bishop_atk_table + 5248);
+	ASSERT(rtable == rook_atk_table + 102400);
+}
 
-const int Bitboard::map_r45[] = {
-	 0,  2,  5,  9, 14, 20, 27, 35,
-	 1,  4,  8, 13, 19, 26, 34, 42,
-	 3,  7, 12, 18, 25, 33, 41, 48,
-	 6, 11, 17, 24, 32, 40, 47, 53,
-	10, 16, 23, 31, 39, 46, 52, 57,
-	15, 22, 30, 38, 45, 51, 56, 60,
-	21, 29, 37, 44, 50, 55, 59, 62,
-	28, 36, 43, 49, 54, 58, 61, 63
-};
+/*
+ * Check whether the CPU supports a fast PEXT instruction (BMI2).
+ * AMD processors before Zen 3 implement PEXT in microcode, which is
+ * much slower than magic multiplication.
+ */
+bool Bitboard::have_pext()
+{
+#ifdef USE_ASM_PEXT
+	unsigned int eax, ebx, ecx, edx;
+	char vendor[13];
+
+	if (__get_cpuid_max(0, NULL) < 7)
+		return false;
+
+	__cpuid(0, eax, ebx, ecx, edx);
+	memcpy(vendor, &ebx, 4);
+	memcpy(vendor + 4, &edx, 4);
+	memcpy(vendor + 8, &ecx, 4);
+	vendor[12] = '\0';
+
+	__cpuid(1, eax, ebx, ecx, edx);
+	unsigned int family = (eax >> 8) & 0xf;
+	if (family == 0xf) {
+		family += (eax >> 20) & 0xff;
+	}
 
-const Square Bitboard::inv_map_r45[] = {		
-                        A1,
-		      A2, B1,
-		    A3, B2, C1,
-		  A4, B3, C2, D1,
-		A5, B4, C3, D2, E1,
-              A6, B5, C4, D3, E2, F1,
-	    A7, B6, C5, D4, E3, F2, G1,
-	  A8, B7, C6, D5, E4, F3, G2, H1,
-	    B8, C7, D6, E5, F4, G3, H2,
-	      C8, D7, E6, F5, G4, H3,
-	        D8, E7, F6, G5, H4,
-		  E8, F7, G6, H5,
-		    F8, G7, H6,
-		      G8, H7,
-		        H8
-};
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	if (!(ebx & (1 << 8)))
+		return false;
 
-const int Bitboard::shift_r45[] = {
-	 0,  1,  3,  6, 10, 15, 21, 28,
-	 1,  3,  6, 10, 15, 21, 28, 36,
-	 3,  6, 10, 15, 21, 28, 36, 43,
-	 6, 10, 15, 21, 28, 36, 43, 49,
-	10, 15, 21, 28, 36, 43, 49, 54,
-	15, 21, 28, 36, 43, 49, 54, 58,
-	21, 28, 36, 43, 49, 54, 58, 61,
-	28, 36, 43, 49, 54, 58, 61, 63
-};
+	if (strcmp(vendor, "AuthenticAMD") == 0 && family < 0x19)
+		return false;
 
-const int Bitboard::diaglen_r45[] = {
-	 1,  2,  3,  4,  5,  6,  7,  8,
-	 2,  3,  4,  5,  6,  7,  8,  7,
-	 3,  4,  5,  6,  7,  8,  7,  6,
-	 4,  5,  6,  7,  8,  7,  6,  5,
-	 5,  6,  7,  8,  7,  6,  5,  4,
-	 6,  7,  8,  7,  6,  5,  4,  3,
-	 7,  8,  7,  6,  5,  4,  3,  2,
-	 8,  7,  6,  5,  4,  3,  2,  1
-};
+	return true;
+#else
+	return false;
+#endif
+}
 
-const int Bitboard::mask_r45[] = {
-	0x01, 0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff,
-	0x03, 0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0x7f,
-	0x07, 0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0x7f, 0x3f,
-	0x0f, 0x1f, 0x3f, 0x7f, 0xff, 0x7f, 0x3f, 0x1f,
-	0x1f, 0x3f, 0x7f, 0xff, 0x7f, 0x3f, 0x1f, 0x0f,
-	0x3f, 0x7f, 0xff, 0x7f, 0x3f, 0x1f, 0x0f, 0x07,
-	0x7f, 0xff, 0x7f, 0x3f, 0x1f, 0x0f, 0x07, 0x03,
-	0xff, 0x7f, 0x3f, 0x1f, 0x0f, 0x07, 0x03, 0x01
-};
+/*
+ * Select slider attack backend: "magic" or "pext".
+ */
+bool Bitboard::set_slider_backend(const std::string & name)
+{
+	if (name == "magic") {
+		use_pext = false;
+	} else if (name == "pext") {
+		if (!have_pext()) {
+			return false;
+		}
+		use_pext = true;
+	} else {
+		return false;
+	}
 
-Bitboard Bitboard::rot_atk_0[64][256];
-Bitboard Bitboard::rot_atk_l90[64][256];
-Bitboard Bitboard::rot_atk_l45[64][256];
-Bitboard Bitboard::rot_atk_r45[64][256];
+	init_sliders();
+	return true;
+}
 
-void Bitboard::init_rot_atk()
+const char * Bitboard::get_slider_backend()
 {
-	Bitboard tmp;
-	int f, t;
-	Square to;
-	
-	for (Bitboard occ=((uint64_t) 0); occ<((uint64_t) 256); occ++) {
-		for (Square from=A1; from<=H8; from++) {
-			
-			/* rot_atk_0[][] */
-			tmp = NULLBITBOARD;
-			f = from % 8;
-			for (t=0; t<8; t++) {
-				if (occ & ray_bb[f][t] || f == t)
-					continue;
-				
-				tmp.setbit(t);
-			}
-			rot_atk_0[from][occ] = tmp << shift_0[from];
+	return use_pext ? "pext" : "magic";
+}
 
-			/* rot_atk_l90[][] */
-			tmp = NULLBITBOARD;
-			f = map_l90[from] % 8;
-			for (t=0; t<8; t++) {
-				if (occ & ray_bb[f][t] || f == t)
-					continue;
+/*
+ * Check whether lsb(), msb() and popcnt() can use CPU instructions,
+ * i.e. whether the CPU supports POPCNT.
+ */
+bool Bitboard::have_hw_bitops()
+{
+#ifdef USE_HW_BITOPS
+	unsigned int eax, ebx, ecx, edx;
 
-				to = inv_map_l90[shift_l90[from] + t];
-				tmp.setbit(to);
-			}
-			rot_atk_l90[from][occ] = tmp;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return false;
 
-			/* rot_atk_l45[][] */
-			tmp = NULLBITBOARD;
-			f = map_l45[from] - shift_l45[from];
-			for (t=0; t<diaglen_l45[from]; t++) {
-				if (occ & ray_bb[f][t] || f == t)
-					continue;
+	return (ecx & bit_POPCNT);
+#else
+	return false;
+#endif
+}
 
-				to = inv_map_l45[shift_l45[from] + t];
-				tmp.setbit(to);
-			}				
-			rot_atk_l45[from][occ] = tmp;
-			
-			/* rot_atk_r45[][] */
-			tmp = NULLBITBOARD;
-			f = map_r45[from] - shift_r45[from];
-			for (t=0; t<diaglen_r45[from]; t++) {
-				if (occ & ray_bb[f][t] || f == t)
-					continue;
-
-				to = inv_map_r45[shift_r45[from] + t];
-				tmp.setbit(to);
-			}				
-			rot_atk_r45[from][occ] = tmp;
+/*
+ * Select backend for lsb(), msb() and popcnt(): "lut" or "hw".
+ */
+bool Bitboard::set_bitops_backend(const std::string & name)
+{
+	if (name == "lut") {
+		use_hw_bitops = false;
+	} else if (name == "hw") {
+		if (!have_hw_bitops()) {
+			return false;
 		}
+		use_hw_bitops = true;
+	} else {
+		return false;
 	}
+
+	return true;
+}
+
+const char * Bitboard::get_bitops_backend()
+{
+	return use_hw_bitops ? "hw" : "lut";
 }
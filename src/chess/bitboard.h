@@ -26,6 +26,8 @@
 #include "common.h"
 #include "basic.h"
 
+#include <string>
+
 
 #define NULLBITBOARD    ((uint64_t) 0)
 
@@ -64,12 +66,12 @@ class Bitboard
 	inline int msb() const;
 	inline int popcnt() const;
 
-	/* Rotated attack functions */
+	/* Slider attack functions */
       public:
-	inline Bitboard atk0(Square from) const;
-	inline Bitboard atkl90(Square from) const;
-	inline Bitboard atkl45(Square from) const;
-	inline Bitboard atkr45(Square from) const;
+	inline static Bitboard bishop_attacks(Square from,
+			const Bitboard & occupied);
+	inline static Bitboard rook_attacks(Square from,
+			const Bitboard & occupied);
 	
 	/* Utility functions */
       public:
@@ -87,41 +89,57 @@ class Bitboard
 	static Bitboard passed_pawn_mask[2][64];
 	static Bitboard isolated_pawn_mask[64];
 	static Bitboard connected_pawn_mask[64];
-
-	static const int map_l90[64];
-	static const int map_l45[64];
-	static const int map_r45[64];
 	
       private:
 	static int8_t lsb_lut[65536];
 	static int8_t msb_lut[65536];
 	static int8_t popcnt_lut[65536];
 	
-	static const Square inv_map_l90[64];
-	static const Square inv_map_l45[64];
-	static const Square inv_map_r45[64];
-	static const int shift_0[64];
-	static const int shift_l90[64];
-	static const int shift_l45[64];
-	static const int shift_r45[64];
-	static const int diaglen_l45[64];
-	static const int diaglen_r45[64];
-	static const int mask_l45[64];
-	static const int mask_r45[64];
-	static Bitboard rot_atk_0[64][256];
-	static Bitboard rot_atk_l90[64][256];
-	static Bitboard rot_atk_l45[64][256];
-	static Bitboard rot_atk_r45[64][256];
+
+	/* Magic bitboards. The attack set of a slider on square sq is
+	 * looked up in table[index], where index is computed from the
+	 * relevant occupied squares (mask) either by multiplication
+	 * with a magic number, or by a PEXT instruction if the CPU
+	 * supports it. */
+	struct magic {
+		Bitboard * table;
+		uint64_t mask;
+		uint64_t magic;
+		unsigned int shift;
+	};
+	static struct magic bishop_magic[64];
+	static struct magic rook_magic[64];
+	static Bitboard bishop_atk_table[5248];
+	static Bitboard rook_atk_table[102400];
+	static const uint64_t bishop_magic_numbers[64];
+	static const uint64_t rook_magic_numbers[64];
+	static bool use_pext;
+
+	/* If set, lsb(), msb() and popcnt() use the CPU's bit scan and
+	 * POPCNT instructions instead of the lookup tables. */
+	static bool use_hw_bitops;
 	
 	/* Static Member Functions */
       public:
 	static void init();
+	static bool have_pext();
+	static bool set_slider_backend(const std::string & name);
+	static const char * get_slider_backend();
+	static bool have_hw_bitops();
+	static bool set_bitops_backend(const std::string & name);
+	static const char * get_bitops_backend();
       private:
 	static void init_attack_bb();
 	static void init_pawn_capt_bb();
 	static void init_ray_bb();
 	static void init_masks();
-	static void init_rot_atk();
+	static void init_sliders();
+	inline static unsigned int magic_index(const struct magic & m,
+			uint64_t occupied);
+	inline static uint64_t pext(uint64_t bits, uint64_t mask);
+	inline static int hw_lsb(uint64_t bits);
+	inline static int hw_msb(uint64_t bits);
+	inline static int hw_popcnt(uint64_t bits);
 };
 
 
@@ -132,6 +150,12 @@ class Bitboard
 //#define USE_ASM_POPCNT	// LUT version is faster
 #include "i386/bitboard_asm.h"
 
+#elif defined(__GNUC__) && defined(__x86_64__)
+
+#define USE_ASM_PEXT
+#define USE_HW_BITOPS
+#include "x86_64/bitboard_asm.h"
+
 #elif defined(WIN32)
 
 #define USE_ASM_LSB
@@ -231,13 +255,19 @@ inline int Bitboard::firstbit() const
 
 
 /*
- * Lookup table version of msb/lsb scan routines.
+ * Lookup table version of msb/lsb scan routines, used if the CPU
+ * instructions are not available.
  * This code was taken from GNU Chess.
  */
 
 #ifndef USE_ASM_LSB
 inline int Bitboard::lsb() const
 {
+#ifdef USE_HW_BITOPS
+	if (use_hw_bitops) {
+		return hw_lsb(bits);
+	}
+#endif
 	if (bits & 0xffff) return lsb_lut[bits & 0xffff];
 	if ((bits >> 16) & 0xffff) return lsb_lut[(bits >> 16) & 0xffff] + 16;
 	if ((bits >> 32) & 0xffff) return lsb_lut[(bits >> 32) & 0xffff] + 32;
@@ -249,6 +279,11 @@ inline int Bitboard::lsb() const
 #ifndef USE_ASM_MSB
 inline int Bitboard::msb() const
 {
+#ifdef USE_HW_BITOPS
+	if (use_hw_bitops) {
+		return hw_msb(bits);
+	}
+#endif
 	if (bits >> 48) return msb_lut[bits >> 48] + 48;
 	if (bits >> 32) return msb_lut[bits >> 32] + 32;
 	if (bits >> 16) return msb_lut[bits >> 16] + 16;
@@ -264,6 +299,11 @@ inline int Bitboard::msb() const
 #ifndef USE_ASM_POPCNT
 inline int Bitboard::popcnt() const
 {
+#ifdef USE_HW_BITOPS
+	if (use_hw_bitops) {
+		return hw_popcnt(bits);
+	}
+#endif
 	return popcnt_lut[bits & 0xffff]
 		+ popcnt_lut[(bits >> 16) & 0xffff]
 		+ popcnt_lut[(bits >> 32) & 0xffff]
@@ -273,29 +313,31 @@ inline int Bitboard::popcnt() const
 
 
 /*
- * Rotated attack functions.
- * They obviously only make sense when called
- * for the matching rotated bitboard.
+ * Slider attack functions.
  */
 
-inline Bitboard Bitboard::atk0(Square from) const
-{
-	return rot_atk_0[from][(bits >> shift_0[from]) & 0xff];
-}
-
-inline Bitboard Bitboard::atkl90(Square from) const
+inline unsigned int Bitboard::magic_index(const struct magic & m,
+		uint64_t occupied)
 {
-	return rot_atk_l90[from][(bits >> shift_l90[from]) & 0xff];
+#ifdef USE_ASM_PEXT
+	if (use_pext) {
+		return pext(occupied, m.mask);
+	}
+#endif
+	return ((occupied & m.mask) * m.magic) >> m.shift;
 }
 
-inline Bitboard Bitboard::atkl45(Square from) const
+inline Bitboard Bitboard::bishop_attacks(Square from,
+		const Bitboard & occupied)
 {
-	return rot_atk_l45[from][(bits >> shift_l45[from]) & mask_l45[from]];
+	const struct magic & m = bishop_magic[from];
+	return m.table[magic_index(m, occupied.bits)];
 }
 
-inline Bitboard Bitboard::atkr45(Square from) const
+inline Bitboard Bitboard::rook_attacks(Square from, const Bitboard & occupied)
 {
-	return rot_atk_r45[from][(bits >> shift_r45[from]) & mask_r45[from]];
+	const struct magic & m = rook_magic[from];
+	return m.table[magic_index(m, occupied.bits)];
 }
 
 
@@ -55,9 +55,6 @@ void Board::clear()
 	position_all[BLACK] = NULLBITBOARD;
 
 	occupied = NULLBITBOARD;
-	occupied_l90 = NULLBITBOARD;
-	occupied_l45 = NULLBITBOARD;
-	occupied_r45 = NULLBITBOARD;
 
 	king[WHITE] = NO_SQUARE;
 	king[BLACK] = NO_SQUARE;
@@ -67,6 +64,11 @@ void Board::clear()
 
 	material[WHITE] = 0;
 	material[BLACK] = 0;
+	matsig = 0;
+	for (int ph = 0; ph < 3; ph++) {
+		pst_score[WHITE][ph] = 0;
+		pst_score[BLACK][ph] = 0;
+	}
 	has_castled[WHITE] = false;
 	has_castled[BLACK] = false;
 
@@ -92,6 +94,8 @@ void Board::make_move(Move mov)
 	hist.oldboard = *this;
 #endif
 	hist.move = mov;
+	hist.hashkey = hashkey;
+	hist.pawnhashkey = pawnhashkey;
 #endif // USE_UNMAKE_MOVE
 	
 	/* Move pieces */
@@ -160,50 +164,55 @@ void Board::make_move(Move mov)
 	hist.flags = flags;
 #endif
 	
-	/* Clear castling flag if a king has moved */
-	if (mov.ptype() == KING) {
-		if (side == WHITE) {
-			clear_flag(WKCASTLE);
-			clear_flag(WQCASTLE);
-		} else {
-			clear_flag(BKCASTLE);
-			clear_flag(BQCASTLE);
-		}
-	}
-
-	/* Clear castling flag if a rook has moved */
-	if (mov.ptype() == ROOK) {
-		switch (mov.from()) {
-			case A1:
-				clear_flag(WQCASTLE);
-				break;
-			case H1:
+	/* Clear castling flags if a king or rook has moved, or if a rook was
+	 * captured. Most positions in the search have no castling rights
+	 * left, so check this first. */
+	if (flags) {
+		/* Clear castling flag if a king has moved */
+		if (mov.ptype() == KING) {
+			if (side == WHITE) {
 				clear_flag(WKCASTLE);
-				break;
-			case A8:
-				clear_flag(BQCASTLE);
-				break;
-			case H8:
-				clear_flag(BKCASTLE);
-				break;
-		}
-	} 
-	
-	/* Clear castling flag if a rook was captured */
-	if (mov.is_capture() && mov.cap_ptype() == ROOK) {
-		switch (mov.to()) {
-			case A1:
 				clear_flag(WQCASTLE);
-				break;
-			case H1:
-				clear_flag(WKCASTLE);
-				break;
-			case A8:
-				clear_flag(BQCASTLE);
-				break;
-			case H8:
+			} else {
 				clear_flag(BKCASTLE);
-				break;
+				clear_flag(BQCASTLE);
+			}
+		}
+
+		/* Clear castling flag if a rook has moved */
+		if (mov.ptype() == ROOK) {
+			switch (mov.from()) {
+				case A1:
+					clear_flag(WQCASTLE);
+					break;
+				case H1:
+					clear_flag(WKCASTLE);
+					break;
+				case A8:
+					clear_flag(BQCASTLE);
+					break;
+				case H8:
+					clear_flag(BKCASTLE);
+					break;
+			}
+		} 
+
+		/* Clear castling flag if a rook was captured */
+		if (mov.is_capture() && mov.cap_ptype() == ROOK) {
+			switch (mov.to()) {
+				case A1:
+					clear_flag(WQCASTLE);
+					break;
+				case H1:
+					clear_flag(WKCASTLE);
+					break;
+				case A8:
+					clear_flag(BQCASTLE);
+					break;
+				case H8:
+					clear_flag(BKCASTLE);
+					break;
+			}
 		}
 	}
 	
@@ -257,6 +266,12 @@ void Board::make_move(Move mov)
 }
 
 #ifdef USE_UNMAKE_MOVE
+/*
+ * Take back a move made by make_move(). Only the pieces are moved back
+ * here, everything else is either restored from the history record
+ * (hash keys, flags, enpassant square, counters) or incrementally
+ * (material, material signature, piece-square table sums), so this is a lot cheaper than make_move().
+ */
 void Board::unmake_move(const BoardHistory & hist)
 {
 	Move mov = hist.move;
@@ -274,48 +289,30 @@ void Board::unmake_move(const BoardHistory & hist)
 	if (side == WHITE) {
 		moveno--;
 	}
-	switch_sides();
-
-	/* Restore enpassant square */
-	set_epsq(hist.epsq);
+	side = XSIDE(side);
+	opponent = XSIDE(opponent);
 
-	/* Restore flags */
-	if (hist.flags & WKCASTLE) {
-		set_flag(WKCASTLE);
-	}
-	if (hist.flags & WQCASTLE) {
-		set_flag(WQCASTLE);
-	}
-	if (hist.flags & BKCASTLE) {
-		set_flag(BKCASTLE);
-	}
-	if (hist.flags & BQCASTLE) {
-		set_flag(BQCASTLE);
-	}
+	/* Restore enpassant square, flags and hash keys */
+	epsq = hist.epsq;
+	flags = hist.flags;
+	hashkey = hist.hashkey;
+	pawnhashkey = hist.pawnhashkey;
 
 	/* Move back pieces */
-	if (mov.flags() & MOVE_CASTLE) {
-		move_piece(mov.to(), mov.from(), side, KING);
+	if (mov.is_castle()) {
+		move_piece_raw(mov.to(), mov.from(), side, KING);
 		switch (mov.to()) {
 			case C1:
-				ASSERT_DEBUG(side == WHITE);
-				ASSERT_DEBUG(flags & WQCASTLE);
-				move_piece(D1, A1, side, ROOK);
+				move_piece_raw(D1, A1, side, ROOK);
 				break;
 			case G1: 
-				ASSERT_DEBUG(side == WHITE);
-				ASSERT_DEBUG(flags & WKCASTLE);
-				move_piece(F1, H1, side, ROOK);
+				move_piece_raw(F1, H1, side, ROOK);
 				break;
 			case C8:
-				ASSERT_DEBUG(side == BLACK);
-				ASSERT_DEBUG(flags & BQCASTLE);
-				move_piece(D8, A8, side, ROOK);
+				move_piece_raw(D8, A8, side, ROOK);
 				break;
 			case G8:
-				ASSERT_DEBUG(side == BLACK);
-				ASSERT_DEBUG(flags & BKCASTLE);
-				move_piece(F8, H8, side, ROOK);
+				move_piece_raw(F8, H8, side, ROOK);
 				break;
 			default:
 				BUG("invalid 'to' square for castling: %d",
@@ -324,30 +321,42 @@ void Board::unmake_move(const BoardHistory & hist)
 		}				
 		has_castled[side] = false;
 	}
-	else if (mov.flags() & MOVE_ENPASSANT) {
+	else if (mov.is_enpassant()) {
 		ASSERT_DEBUG(mov.to() == epsq);
-		move_piece(mov.to(), mov.from(), side, PAWN);
-		place_piece(get_eppawn(), opponent, PAWN);
-	}
-	else if (mov.flags() & MOVE_CAPTURE) {
-		if (mov.flags() & MOVE_PROMOTION) {
-			remove_piece(mov.to(), side, mov.promote_to());
-			place_piece(mov.to(), opponent, mov.cap_ptype());
-			place_piece(mov.from(), side, PAWN);
+		move_piece_raw(mov.to(), mov.from(), side, PAWN);
+		place_piece_raw(get_eppawn(), opponent, PAWN);
+		material[opponent] += mat_values[PAWN];
+		matsig += MATSIG(opponent, PAWN, 1);
+	}
+	else if (mov.is_capture()) {
+		if (mov.is_promotion()) {
+			remove_piece_raw(mov.to(), side, mov.promote_to());
+			place_piece_raw(mov.to(), opponent, mov.cap_ptype());
+			place_piece_raw(mov.from(), side, PAWN);
+			material[side] += mat_values[PAWN]
+				- mat_values[mov.promote_to()];
+			matsig += MATSIG(side, PAWN, 1)
+				- MATSIG(side, mov.promote_to(), 1);
 		} else {
-			move_piece(mov.to(), mov.from(), side, mov.ptype());
-			place_piece(mov.to(), opponent, mov.cap_ptype());
+			move_piece_raw(mov.to(), mov.from(), side, mov.ptype());
+			place_piece_raw(mov.to(), opponent, mov.cap_ptype());
 		}
+		material[opponent] += mat_values[mov.cap_ptype()];
+		matsig += MATSIG(opponent, mov.cap_ptype(), 1);
 	}
-	else if (mov.flags() & MOVE_NORMAL) {
-		if (mov.flags() & MOVE_PROMOTION) {
-			remove_piece(mov.to(), side, mov.promote_to());
-			place_piece(mov.from(), side, PAWN);
+	else if (mov.is_normal()) {
+		if (mov.is_promotion()) {
+			remove_piece_raw(mov.to(), side, mov.promote_to());
+			place_piece_raw(mov.from(), side, PAWN);
+			material[side] += mat_values[PAWN]
+				- mat_values[mov.promote_to()];
+			matsig += MATSIG(side, PAWN, 1)
+				- MATSIG(side, mov.promote_to(), 1);
 		} else {
-			move_piece(mov.to(), mov.from(), side, mov.ptype());
+			move_piece_raw(mov.to(), mov.from(), side, mov.ptype());
 		}
 	}
-	else if (mov.flags() & MOVE_NULL) {
+	else if (mov.is_null()) {
 		/* nothing */
 	}
 	else {
@@ -550,21 +559,10 @@ void Board::switch_sides()
 
 void Board::place_piece(Square sq, Color side, Piece ptype)
 {
-	ASSERT_DEBUG(color_at(sq) == NO_COLOR);
-	ASSERT_DEBUG(piece_at(sq) == NO_PIECE);
-	
-	position[side][ptype].setbit(sq);
-	position_all[side].setbit(sq);
-	occupied.setbit(sq);
-	occupied_l90.setbit(Bitboard::map_l90[sq]);
-	occupied_l45.setbit(Bitboard::map_l45[sq]);
-	occupied_r45.setbit(Bitboard::map_r45[sq]);
-		
-	if (ptype == KING) {
-		king[side] = sq;
-	}
+	place_piece_raw(sq, side, ptype);
 	
 	material[side] += mat_values[ptype];
+	matsig += MATSIG(side, ptype, 1);
 	
 	hashkey ^= hashkeys[side][ptype][sq];
 	if (ptype == PAWN) {
@@ -574,21 +572,10 @@ void Board::place_piece(Square sq, Color side, Piece ptype)
 
 void Board::remove_piece(Square sq, Color side, Piece ptype)
 {
-	ASSERT_DEBUG(color_at(sq) == side);
-	ASSERT_DEBUG(piece_at(sq) == ptype);
-	
-	position[side][ptype].clearbit(sq);
-	position_all[side].clearbit(sq);
-	occupied.clearbit(sq);
-	occupied_l90.clearbit(Bitboard::map_l90[sq]);
-	occupied_l45.clearbit(Bitboard::map_l45[sq]);
-	occupied_r45.clearbit(Bitboard::map_r45[sq]);
-
-	if (ptype == KING) {
-		king[side] = NO_SQUARE;
-	}
+	remove_piece_raw(sq, side, ptype);
 	
 	material[side] -= mat_values[ptype];
+	matsig -= MATSIG(side, ptype, 1);
 	
 	hashkey ^= hashkeys[side][ptype][sq];
 	if (ptype == PAWN) {
@@ -598,27 +585,7 @@ void Board::remove_piece(Square sq, Color side, Piece ptype)
 	
 void Board::move_piece(Square from, Square to, Color side, Piece ptype)
 {
-	ASSERT_DEBUG(color_at(from) == side);
-	ASSERT_DEBUG(piece_at(from) == ptype);
-	ASSERT_DEBUG(color_at(to) == NO_COLOR);
-	ASSERT_DEBUG(piece_at(to) == NO_PIECE);
-	
-	position[side][ptype].clearbit(from);
-	position[side][ptype].setbit(to);
-	position_all[side].clearbit(from);
-	position_all[side].setbit(to);
-	occupied.clearbit(from);
-	occupied.setbit(to);
-	occupied_l90.clearbit(Bitboard::map_l90[from]);
-	occupied_l90.setbit(Bitboard::map_l90[to]);
-	occupied_l45.clearbit(Bitboard::map_l45[from]);
-	occupied_l45.setbit(Bitboard::map_l45[to]);
-	occupied_r45.clearbit(Bitboard::map_r45[from]);
-	occupied_r45.setbit(Bitboard::map_r45[to]);
-
-	if (ptype == KING) {
-		king[side] = to;
-	}
+	move_piece_raw(from, to, side, ptype);
 	
 	hashkey ^= hashkeys[side][ptype][from];
 	hashkey ^= hashkeys[side][ptype][to];
@@ -41,6 +41,13 @@
 #define WCASTLE		(WKCASTLE | WQCASTLE)
 #define BCASTLE		(BKCASTLE | BQCASTLE)
 
+/* Material signature: the number of pieces of each color and type,
+ * 4 bits each. Used as key for the material hash table. */
+#define MATSIG_SHIFT(side, ptype)	(24 * (side) + 4 * (ptype))
+#define MATSIG(side, ptype, n)		((uint64_t) (n) << MATSIG_SHIFT(side, ptype))
+#define MATSIG_COUNT(sig, side, ptype)	\
+	((unsigned int) ((sig) >> MATSIG_SHIFT(side, ptype)) & 0xf)
+
 #ifdef USE_UNMAKE_MOVE
 /* Forward declaration */
 class BoardHistory;
@@ -59,9 +66,6 @@ class Board
 	Bitboard	position[2][6];
 	Bitboard	position_all[2];
 	Bitboard 	occupied;
-	Bitboard 	occupied_l90;
-	Bitboard 	occupied_l45;
-	Bitboard 	occupied_r45;
 
 	Square 		king[2];
 	
@@ -69,6 +73,11 @@ class Board
 	Square 		epsq;
 
 	int 		material[2];
+	uint64_t	matsig;
+
+	/* Sum of the piece-square table values of each side's pieces,
+	 * for each game phase. */
+	int		pst_score[2][3];
 	bool 		has_castled[2];
 
 	unsigned int	pce_movecnt[64];
@@ -106,6 +115,9 @@ class Board
 	Hashkey get_pawnhashkey() const
 	{ return pawnhashkey; }
 
+	uint64_t get_matsig() const
+	{ return matsig; }
+
 	inline Hashkey get_hashkey_noside() const;
 	inline unsigned int get_pce_movecnt(Square sq) const;
 
@@ -159,6 +171,10 @@ class Board
 	void place_piece(Square sq, Color side, Piece ptype);
 	void remove_piece(Square sq, Color side, Piece ptype);
 	void move_piece(Square from, Square to, Color side, Piece ptype);
+	inline void place_piece_raw(Square sq, Color side, Piece ptype);
+	inline void remove_piece_raw(Square sq, Color side, Piece ptype);
+	inline void move_piece_raw(Square from, Square to, Color side,
+			Piece ptype);
 	void set_flag(unsigned int flag);
 	void clear_flag(unsigned int flag);
 	void set_epsq(Square sq);
@@ -172,8 +188,10 @@ class Board
 	/* Attack functions, defined in board_attack.cc */
       public:
 	bool is_attacked(Square to, Color atkside) const;
+	int see(Move mov) const;
       private:
 	Bitboard attackers(Square to, Color atkside) const;
+	Bitboard all_attackers(Square to, const Bitboard & occ) const;
 	Bitboard pinned(Square to, Color side) const;
 	inline Bitboard pawn_captures(Square from, Color side) const;
 	inline Bitboard pawn_noncaptures(Square from, Color side) const;
@@ -226,6 +244,7 @@ class Board
 	Move parse_move(const std::string & str) const;
 	Move parse_move_1(const std::string & str) const;
 	Move do_parse_move_1(const std::string & str) const;
+	Move parse_san(const char * s, unsigned int len) const;
 	bool operator==(const Board & board) const;     
 
 	
@@ -239,6 +258,10 @@ class Board
 	static Hashkey hash_bk;
 	static Hashkey hash_bq;
 
+	/* Piece-square tables, indexed by color, piece, square and game
+	 * phase. They are filled by Evaluator::init(). */
+	static int pst[2][6][64][3];
+
 	/* Static Member Functions */
       public:
 	static void init();
@@ -247,6 +270,8 @@ class Board
 #ifdef USE_UNMAKE_MOVE
 /* 
  * This class contains all necessary information to unmake a previous move.
+ * It is kept small (32 bytes in non-debug builds), since the search stores
+ * one per ply instead of a copy of the board.
  */
 class BoardHistory
 {
@@ -257,11 +282,13 @@ class BoardHistory
 	 * was correctly restored. */
 	Board oldboard;
 #endif
+	Hashkey hashkey;
+	Hashkey pawnhashkey;
 	Move move;
-	int movecnt50;
-	unsigned int flags;
-	Square epsq;
 	unsigned int pce_movecnt_to;
+	int16_t movecnt50;
+	uint8_t flags;
+	int8_t epsq;
 };
 #endif
 
@@ -287,6 +314,72 @@ inline unsigned int Board::get_pce_movecnt(Square sq) const
 	return pce_movecnt[sq];
 }
 
+/*
+ * Like place_piece(), remove_piece() and move_piece(), but without
+ * updating material and hash keys. The piece-square table sums are
+ * updated here, so that unmake_move() restores them as well.
+ */
+inline void Board::place_piece_raw(Square sq, Color side, Piece ptype)
+{
+	ASSERT_DEBUG(color_at(sq) == NO_COLOR);
+	ASSERT_DEBUG(piece_at(sq) == NO_PIECE);
+	
+	position[side][ptype].setbit(sq);
+	position_all[side].setbit(sq);
+	occupied.setbit(sq);
+
+	for (int ph = 0; ph < 3; ph++) {
+		pst_score[side][ph] += pst[side][ptype][sq][ph];
+	}
+		
+	if (ptype == KING) {
+		king[side] = sq;
+	}
+}
+
+inline void Board::remove_piece_raw(Square sq, Color side, Piece ptype)
+{
+	ASSERT_DEBUG(color_at(sq) == side);
+	ASSERT_DEBUG(piece_at(sq) == ptype);
+	
+	position[side][ptype].clearbit(sq);
+	position_all[side].clearbit(sq);
+	occupied.clearbit(sq);
+
+	for (int ph = 0; ph < 3; ph++) {
+		pst_score[side][ph] -= pst[side][ptype][sq][ph];
+	}
+
+	if (ptype == KING) {
+		king[side] = NO_SQUARE;
+	}
+}
+
+inline void Board::move_piece_raw(Square from, Square to, Color side,
+		Piece ptype)
+{
+	ASSERT_DEBUG(color_at(from) == side);
+	ASSERT_DEBUG(piece_at(from) == ptype);
+	ASSERT_DEBUG(color_at(to) == NO_COLOR);
+	ASSERT_DEBUG(piece_at(to) == NO_PIECE);
+	
+	position[side][ptype].clearbit(from);
+	position[side][ptype].setbit(to);
+	position_all[side].clearbit(from);
+	position_all[side].setbit(to);
+	occupied.clearbit(from);
+	occupied.setbit(to);
+
+	for (int ph = 0; ph < 3; ph++) {
+		pst_score[side][ph] += pst[side][ptype][to][ph]
+			- pst[side][ptype][from][ph];
+	}
+
+	if (ptype == KING) {
+		king[side] = to;
+	}
+}
+
 inline bool Board::in_check() const
 {
 	return is_attacked(get_king(side), opponent);
@@ -319,7 +412,7 @@ inline int Board::get_material(Color side) const
  * Note that they don't filter out illegal captures
  * of own pieces.
  * 
- * Rotated bitboards are used to calculate
+ * Magic bitboards are used to calculate
  * bishop, rook and queen attacks.
  */
 
@@ -355,12 +448,12 @@ inline Bitboard Board::knight_attacks(Square from) const
 
 inline Bitboard Board::bishop_attacks(Square from) const
 {
-	return (occupied_l45.atkl45(from) | occupied_r45.atkr45(from));
+	return Bitboard::bishop_attacks(from, occupied);
 }
 
 inline Bitboard Board::rook_attacks(Square from) const
 {
-	return (occupied.atk0(from) | occupied_l90.atkl90(from));
+	return Bitboard::rook_attacks(from, occupied);
 }
 
 inline Bitboard Board::queen_attacks(Square from) const
@@ -26,6 +26,8 @@
 #include "bitboard.h"
 #include "basic.h"
 
+#include <algorithm>
+
 /*
  * Returns true if square 'to' is attacked by any piece of 'atkside'.
  */
@@ -83,6 +85,104 @@ Bitboard Board::attackers(Square to, Color atkside) const
 	return ret_bb;
 }
 
+/*
+ * Returns a Bitboard with all pieces of both sides that attack the square
+ * 'to', if only the squares in 'occ' were occupied.
+ */
+Bitboard Board::all_attackers(Square to, const Bitboard & occ) const
+{
+	return (Bitboard::pawn_capt_bb[BLACK][to] & get_pawns(WHITE))
+		| (Bitboard::pawn_capt_bb[WHITE][to] & get_pawns(BLACK))
+		| (knight_attacks(to) & (get_knights(WHITE)
+					| get_knights(BLACK)))
+		| (Bitboard::bishop_attacks(to, occ)
+			& (get_bishops(WHITE) | get_bishops(BLACK)
+				| get_queens(WHITE) | get_queens(BLACK)))
+		| (Bitboard::rook_attacks(to, occ)
+			& (get_rooks(WHITE) | get_rooks(BLACK)
+				| get_queens(WHITE) | get_queens(BLACK)))
+		| (king_attacks(to) & (get_kings(WHITE) | get_kings(BLACK)));
+}
+
+/*
+ * Static exchange evaluation: Returns the material balance of the sequence
+ * of captures on the 'to' square of 'mov', from the point of view of the
+ * moving side. Both sides capture with their least valuable piece first,
+ * and may stop capturing at any time. Sliders behind a capturing piece
+ * (x-rays) join the exchange once the piece has captured. Pins are not
+ * considered.
+ */
+int Board::see(Move mov) const
+{
+	/* The king's value is only used to stop exchanges in which a king
+	 * would capture a defended piece. */
+	static const int see_values[6] = { 100, 300, 325, 500, 900, 10000 };
+
+	const Square to = mov.to();
+	Bitboard occ = occupied;
+	Bitboard from_bb = NULLBITBOARD;
+	from_bb.setbit(mov.from());
+	if (mov.is_enpassant()) {
+		occ.clearbit(get_eppawn());
+	}
+
+	const Bitboard diag = get_bishops(WHITE) | get_bishops(BLACK)
+		| get_queens(WHITE) | get_queens(BLACK);
+	const Bitboard straight = get_rooks(WHITE) | get_rooks(BLACK)
+		| get_queens(WHITE) | get_queens(BLACK);
+	Bitboard atk = all_attackers(to, occ);
+
+	/* gain[d] is the balance after the d-th capture, from the point of
+	 * view of the side that made it, if the exchange ended there. */
+	int gain[34];
+	int d = 0;
+	gain[0] = mov.mat_gain();
+	Piece ptype = mov.is_promotion() ? mov.promote_to() : mov.ptype();
+	Color atkside = side;
+
+	for (;;) {
+		d++;
+		gain[d] = see_values[ptype] - gain[d-1];
+		if (-gain[d-1] < 0 && gain[d] < 0) {
+			/* Neither side can improve by going on. */
+			break;
+		}
+
+		/* Remove the last capturing piece, and add sliders that
+		 * were behind it. This depends on the line between the
+		 * piece and the target square, not on the piece type:
+		 * a king or a pawn push can uncover sliders, too. */
+		occ &= ~from_bb;
+		if (from_bb & Bitboard::attack_bb[BISHOP][to]) {
+			atk |= Bitboard::bishop_attacks(to, occ) & diag;
+		} else if (from_bb & Bitboard::attack_bb[ROOK][to]) {
+			atk |= Bitboard::rook_attacks(to, occ) & straight;
+		}
+		atk &= occ;
+
+		/* Find the least valuable piece of the other side to
+		 * capture next. */
+		atkside = XSIDE(atkside);
+		Bitboard bb = atk & get_pieces(atkside);
+		if (!bb) {
+			break;
+		}
+		for (ptype = PAWN; ptype <= KING; ptype++) {
+			from_bb = bb & position[atkside][ptype];
+			if (from_bb) {
+				break;
+			}
+		}
+		from_bb = ((uint64_t) from_bb) & -((uint64_t) from_bb);
+	}
+
+	while (--d) {
+		gain[d-1] = -std::max(-gain[d-1], gain[d]);
+	}
+
+	return gain[0];
+}
+
 /*
  * Find all pieces of 'side' that are pinned to side's piece on square 'to'.
  */
@@ -33,6 +33,7 @@ Hashkey Board::hash_wk;
 Hashkey Board::hash_wq;
 Hashkey Board::hash_bk;
 Hashkey Board::hash_bq;
+int Board::pst[2][6][64][3];
 
 void Board::init()
 {
@@ -66,27 +66,29 @@ bool Board::is_valid() const
 
 bool Board::is_material_draw() const
 {
-	if (material[WHITE] == 0 && material[BLACK] == 0) {
-		/* only kings left -> draw */
-		return true;
-	} else if (get_pawns(WHITE) || get_pawns(BLACK)) {
-		/* there are still pawns -> no draw */
- 		return false;
-	} else if ((material[WHITE] < mat_values[ROOK]
-			|| (material[WHITE] == 2 * mat_values[KNIGHT]
-				&& get_knights(WHITE).popcnt() == 2))
-		&& (material[BLACK] < mat_values[ROOK]
-			|| (material[BLACK] == 2 * mat_values[KNIGHT]
-				&& get_knights(BLACK).popcnt() == 2))) {
-		/* both sides have only a knight or a bishop -> draw
-		 * both sides have <= 2 knights only -> draw */
-		return true;
+	/* Pawns, rooks or queens left -> no draw */
+	const uint64_t heavy = MATSIG(WHITE, PAWN, 0xf)
+		| MATSIG(WHITE, ROOK, 0xf) | MATSIG(WHITE, QUEEN, 0xf)
+		| MATSIG(BLACK, PAWN, 0xf)
+		| MATSIG(BLACK, ROOK, 0xf) | MATSIG(BLACK, QUEEN, 0xf);
+	if (matsig & heavy) {
+		return false;
+	}
+
+	/* only kings left -> draw
+	 * both sides have only a knight or a bishop -> draw
+	 * both sides have <= 2 knights only -> draw */
+	for (int c = WHITE; c <= BLACK; c++) {
+		const unsigned int n = MATSIG_COUNT(matsig, c, KNIGHT);
+		const unsigned int b = MATSIG_COUNT(matsig, c, BISHOP);
+		if (n + b > 1 && !(n == 2 && b == 0)) {
+			return false;
+		}
 	}
 		
 	/* TODO  more */
 	
-	
-	return false;
+	return true;
 }
 
 void Board::print(FILE * fp, Move last_move) const
@@ -753,6 +755,184 @@ Move Board::do_parse_move_1(const std::string & str) const
 }
 
 
+/*
+ * Fast SAN parser for bulk PGN import (see PGNReader). s need not be
+ * null-terminated. Plain pawn and piece moves are resolved directly from
+ * the attack bitboards, without building strings or checking legality;
+ * everything else (castling, ambiguous piece moves, coordinate notation)
+ * is passed to parse_move_1().
+ *
+ * The returned move is valid, but may leave the own king in check. The
+ * caller must check Board::is_legal() after making it.
+ */
+Move Board::parse_san(const char * s, unsigned int len) const
+{
+	/* Strip check, mate and annotation suffixes. */
+	while (len > 0 && (s[len-1] == '+' || s[len-1] == '#'
+				|| s[len-1] == '!' || s[len-1] == '?')) {
+		len--;
+	}
+	if (len < 2) {
+		return NO_MOVE;
+	}
+
+	if (s[0] >= 'a' && s[0] <= 'h') {
+		/* Pawn move */
+		Piece promo_ptype = NO_PIECE;
+		switch (s[len-1]) {
+		case 'N': promo_ptype = KNIGHT;	break;
+		case 'B': promo_ptype = BISHOP;	break;
+		case 'R': promo_ptype = ROOK;	break;
+		case 'Q': promo_ptype = QUEEN;	break;
+		}
+		if (promo_ptype != NO_PIECE) {
+			len--;
+			if (len > 0 && s[len-1] == '=') {
+				len--;
+			}
+		}
+
+		const char * t = s + len - 2;
+		if (!(len == 2 || (len == 4 && s[1] == 'x'))
+				|| t[0] < 'a' || t[0] > 'h'
+				|| t[1] < '1' || t[1] > '8') {
+			goto fallback;
+		}
+
+		Square to = SQUARE(t[1] - '1', t[0] - 'a');
+		int back = (side == WHITE) ? -8 : 8;
+		if ((RNK(to) == ((side == WHITE) ? RANK8 : RANK1))
+				!= (promo_ptype != NO_PIECE)) {
+			return NO_MOVE;
+		} else if (RNK(to) == ((side == WHITE) ? RANK1 : RANK8)) {
+			/* No pawn can move to its own back rank. */
+			return NO_MOVE;
+		}
+
+		Square from;
+		if (len == 2) {
+			if (occupied.testbit(to)) {
+				return NO_MOVE;
+			}
+			from = to + back;
+			if (from < 0 || from > 63) {
+				return NO_MOVE;
+			} else if (!get_pawns(side).testbit(from)) {
+				if (occupied.testbit(from)
+						|| RNK(to) != ((side == WHITE)
+							? RANK4 : RANK5)) {
+					return NO_MOVE;
+				}
+				from += back;
+				if (from < 0 || from > 63
+						|| !get_pawns(side).testbit(from)) {
+					return NO_MOVE;
+				}
+			}
+
+			if (promo_ptype != NO_PIECE) {
+				return Move::promotion(from, to, promo_ptype);
+			} else {
+				return Move::normal(from, to, PAWN);
+			}
+		} else {
+			int df = (s[0] - 'a') - FIL(to);
+			if (df != 1 && df != -1) {
+				return NO_MOVE;
+			}
+			from = to + back + df;
+			if (from < 0 || from > 63
+					|| !get_pawns(side).testbit(from)) {
+				return NO_MOVE;
+			}
+
+			if (to == epsq) {
+				return Move::enpassant(from, to);
+			} else if (!get_pieces(opponent).testbit(to)) {
+				return NO_MOVE;
+			}
+
+			Piece cap_ptype = piece_at(to);
+			if (promo_ptype != NO_PIECE) {
+				return Move::promotion_capture(from, to,
+						promo_ptype, cap_ptype);
+			} else {
+				return Move::capture(from, to, PAWN, cap_ptype);
+			}
+		}
+	} else {
+		/* Piece move */
+		Piece ptype;
+		switch (s[0]) {
+		case 'N': ptype = KNIGHT;	break;
+		case 'B': ptype = BISHOP;	break;
+		case 'R': ptype = ROOK;		break;
+		case 'Q': ptype = QUEEN;	break;
+		case 'K': ptype = KING;		break;
+		default:
+			goto fallback;
+		}
+
+		const char * t = s + len - 2;
+		if (len < 3 || t[0] < 'a' || t[0] > 'h'
+				|| t[1] < '1' || t[1] > '8') {
+			goto fallback;
+		}
+		Square to = SQUARE(t[1] - '1', t[0] - 'a');
+		if (get_pieces(side).testbit(to)) {
+			return NO_MOVE;
+		}
+
+		Bitboard from_bb;
+		switch (ptype) {
+		case KNIGHT:
+			from_bb = knight_attacks(to) & get_knights(side);
+			break;
+		case BISHOP:
+			from_bb = bishop_attacks(to) & get_bishops(side);
+			break;
+		case ROOK:
+			from_bb = rook_attacks(to) & get_rooks(side);
+			break;
+		case QUEEN:
+			from_bb = queen_attacks(to) & get_queens(side);
+			break;
+		default:
+			from_bb = king_attacks(to) & get_kings(side);
+			break;
+		}
+
+		/* Disambiguation by file and/or rank, and 'x' */
+		for (const char * p = s + 1; p < t; p++) {
+			if (*p >= 'a' && *p <= 'h') {
+				from_bb &= Bitboard::file[*p - 'a'];
+			} else if (*p >= '1' && *p <= '8') {
+				from_bb &= Bitboard::rank[*p - '1'];
+			} else if (*p != 'x' && *p != ':') {
+				return NO_MOVE;
+			}
+		}
+
+		if (!from_bb) {
+			return NO_MOVE;
+		} else if (((uint64_t) from_bb & ((uint64_t) from_bb - 1)) != 0) {
+			/* Only one of the pieces is not pinned. */
+			goto fallback;
+		}
+
+		Square from = from_bb.firstbit();
+		if (occupied.testbit(to)) {
+			return Move::capture(from, to, ptype, piece_at(to));
+		} else {
+			return Move::normal(from, to, ptype);
+		}
+	}
+
+fallback:
+	return parse_move_1(std::string(s, len));
+}
+
+
 bool Board::operator==(const Board & board) const
 {
 	for (Piece pce = PAWN; pce <= KING; pce++) {
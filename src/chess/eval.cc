@@ -23,6 +23,7 @@
 
 #include "common.h"
 #include "eval.h"
+#include "evalplugins.h"
 #include "bitboard.h"
 #include "board.h"
 
@@ -44,6 +45,52 @@ bool Evaluator::is_draw(const Board & board)
 	return false;
 }
 
+void Evaluator::init()
+{
+	init_pst();
+	init_control();
+#ifdef USE_MATERIALHASH
+	init_kpk();
+#endif
+}
+
+/*
+ * Material score from the side to move's point of view. Returns true if
+ * this is already the final score, i.e. the position is a material draw
+ * or a recognized endgame.
+ */
+bool Evaluator::eval_material(const Board & board, int * score)
+{
+	const Color side = board.get_side();
+
+#ifdef USE_MATERIALHASH
+	bool found;
+	MaterialHashEntry * e = materialhashtable.probe(board.get_matsig(),
+			&found);
+	if (!found) {
+		init_material_entry(e);
+	}
+	matentry = e;
+
+	if (e->draw) {
+		*score = DRAW;
+		return true;
+	} else if (e->endgame) {
+		*score = e->endgame(board, e->strongside);
+		if (side != e->strongside) {
+			*score = -*score;
+		}
+		return true;
+	}
+
+	*score = (side == WHITE) ? e->balance : -e->balance;
+#else
+	*score = material_balance(board.get_material(side),
+			board.get_material(XSIDE(side)));
+#endif
+	return false;
+}
+
 #if 1
 /*
  * Calculate material balance. To discourage piece tradeing 
@@ -91,8 +138,11 @@ int Evaluator::material_balance(int ms, int mxs)
  */
 unsigned int Evaluator::get_phase(const Board & board)
 {
-	const int mat = board.material[WHITE] + board.material[BLACK];
+	return get_phase(board.material[WHITE] + board.material[BLACK]);
+}
 
+unsigned int Evaluator::get_phase(int mat)
+{
 	/* Starting material is 7900 */
 	if (mat > 7000) {
 		return OPENING;
@@ -111,7 +161,11 @@ void Evaluator::setup(const Board * board)
 //	const Color side = board->get_side();
 //	const Color xside = XSIDE(side);
 
+#ifdef USE_MATERIALHASH
+	phase = matentry->phase;
+#else
 	phase = get_phase(*board);
+#endif
 
 	if (pawnhashtable) {
 		if (pawnhashtable->probe(board->get_pawnhashkey(),
@@ -126,10 +180,74 @@ void Evaluator::setup(const Board * board)
 		pawnhashentry.set_invalid();
 	}
 	
+	/* The attack maps are computed by the first plugin that needs
+	 * them, see need_attacks(). */
+	attacks_valid = false;
+
 //	pinned_on_king[side] = board->pinned(board->get_king(side), side);
 //	pinned_on_king[xside] = board->pinned(board->get_king(xside), xside);
 }
 
+/*
+ * Compute the attack maps of one side. The number of attackers of each
+ * square is kept in three bit planes, and each piece's attack set is
+ * added with a bitwise adder, which is much cheaper than calling
+ * Board::attackers() for every square.
+ */
+void Evaluator::setup_attacks(Color side)
+{
+	uint64_t c0 = 0, c1 = 0, c2 = 0;
+
+	for (int p = PAWN; p <= KING; p++) {
+		attacks_by[side][p] = NULLBITBOARD;
+
+		Bitboard pieces = board->position[side][p];
+		while (pieces) {
+			Square sq = pieces.firstbit();
+			pieces.clearbit(sq);
+
+			Bitboard atk;
+			switch (p) {
+			case PAWN:
+				atk = Bitboard::pawn_capt_bb[side][sq];
+				break;
+			case KNIGHT:
+				atk = board->knight_attacks(sq);
+				break;
+			case BISHOP:
+				atk = board->bishop_attacks(sq);
+				break;
+			case ROOK:
+				atk = board->rook_attacks(sq);
+				break;
+			case QUEEN:
+				atk = board->queen_attacks(sq);
+				break;
+			default:
+				atk = board->king_attacks(sq);
+				break;
+			}
+			attacks_from[sq] = atk;
+			attacks_by[side][p] |= atk;
+
+			/* Add one to the count of the attacked squares,
+			 * except where it is already 7. */
+			const uint64_t a = (uint64_t) atk & ~(c0 & c1 & c2);
+			const uint64_t carry0 = c0 & a;
+			const uint64_t carry1 = c1 & carry0;
+			c0 ^= a;
+			c1 ^= carry0;
+			c2 ^= carry1;
+		}
+	}
+
+	attack_count[side][0] = c0;
+	attack_count[side][1] = c1;
+	attack_count[side][2] = c2;
+	attacks_all[side] = c0 | c1 | c2;
+	attacks_double[side] = c1 | c2;
+}
+
 void Evaluator::finish()
 {
 	if (pawnhashtable) {
@@ -146,24 +264,54 @@ void Evaluator::finish()
  * 
  *****************************************************************************/
 
+/*
+ * Plugins are sorted by cost, so that the cheap ones can cause a lazy
+ * cutoff before the expensive ones are called. The margins are not strict
+ * maxima, but values that are exceeded only in a few percent of the
+ * evaluations during the benchmark searches. Therefore a lazy evaluation
+ * only returns the bound that was failed, see Evaluator::eval().
+ * The pawn evaluation must come first, because finish() stores its
+ * result in the pawn hash table. Square control is the only phase 2
+ * plugin, it is skipped if the position is not balanced anyway.
+ */
 const struct score_plugin Evaluator::plugins[] = {
-	{ "pawns",	&Evaluator::score_pawns		},
-	{ "knights",	&Evaluator::score_knights	},
-	{ "bishops",	&Evaluator::score_bishops	},
-	{ "rooks",	&Evaluator::score_rooks		},
-	{ "queens",	&Evaluator::score_queens	},
-	{ "king",	&Evaluator::score_king		},
-	{ "devel",	&Evaluator::score_devel		},
-	{ "combo",	&Evaluator::score_combo		},
-
-	{ NULL, NULL }
+	{ "pawns",	&Evaluator::score_pawns,	220, false },
+	{ "pst",	&Evaluator::score_pst,		200, false },
+	{ "devel",	&Evaluator::score_devel,	 40, false },
+	{ "king",	&Evaluator::score_king,		  0, false },
+	{ "knights",	&Evaluator::score_knights,	 20, false },
+	{ "bishops",	&Evaluator::score_bishops,	 60, false },
+	{ "queens",	&Evaluator::score_queens,	 10, false },
+	{ "combo",	&Evaluator::score_combo,	 40, false },
+	{ "rooks",	&Evaluator::score_rooks,	 60, false },
+	{ "control",	&Evaluator::score_control,	 50, true },
+
+	{ NULL, NULL, 0, false }
 };
 
-const struct score_plugin Evaluator::plugins2[] = {
-	{ "control",	&Evaluator::score_control	},
-
-	{ NULL, NULL }
-};
+unsigned int Evaluator::run_plugins(Color side, int * score,
+		int alpha, int beta)
+{
+	/* Same order as plugins[] */
+	typedef PluginList<&Evaluator::score_pawns,
+		PluginList<&Evaluator::score_pst,
+		PluginList<&Evaluator::score_devel,
+		PluginList<&Evaluator::score_king,
+		PluginList<&Evaluator::score_knights,
+		PluginList<&Evaluator::score_bishops,
+		PluginList<&Evaluator::score_queens,
+		PluginList<&Evaluator::score_combo,
+		PluginList<&Evaluator::score_rooks,
+		PluginList<&Evaluator::score_control,
+		PluginListEnd> > > > > > > > > > List;
+	ASSERT_DEBUG(List::matches(plugins));
+
+	if (side == WHITE) {
+		return List::run<WHITE, 0>(this, score, alpha, beta);
+	} else {
+		return List::run<BLACK, 0>(this, score, alpha, beta);
+	}
+}
 
 
 const int Evaluator::pawn_scores_opening[] = {
@@ -232,6 +380,52 @@ const int Evaluator::king_scores_endgame[] = {
 	  0,  0,  0,  0,  0,  0,  0,  0
 };
 
+/*
+ * Fill the piece-square tables of class Board from the tables above.
+ * Board keeps the sums up to date while pieces are moved, so that
+ * score_pst() does not need to look at the pieces at all.
+ */
+void Evaluator::init_pst()
+{
+	for (int c = WHITE; c <= BLACK; c++) {
+		for (Square sq = A1; sq <= H8; sq++) {
+			const Square idx = (c == WHITE) ? sq
+				: SQUARE(XRANK(RNK(sq)),FIL(sq));
+
+			for (int p = PAWN; p <= KING; p++) {
+				for (int ph = OPENING; ph <= ENDGAME; ph++) {
+					Board::pst[c][p][sq][ph] = 0;
+				}
+			}
+
+			int * pawn = Board::pst[c][PAWN][sq];
+			pawn[OPENING] = pawn_scores_opening[idx];
+			pawn[MIDGAME] = pawn_scores_midgame[idx];
+			pawn[ENDGAME] = pawn_scores_endgame[idx];
+
+			int * knight = Board::pst[c][KNIGHT][sq];
+			knight[OPENING] = knight_scores[sq];
+			knight[MIDGAME] = knight_scores[sq];
+			knight[ENDGAME] = knight_scores[sq];
+
+			int * king = Board::pst[c][KING][sq];
+			king[OPENING] = king_scores[sq];
+			king[MIDGAME] = king_scores[sq];
+			king[ENDGAME] = king_scores_endgame[sq];
+		}
+	}
+}
+
+
+/*
+ * Piece-square tables.
+ */
+
+int Evaluator::score_pst(Color side)
+{
+	return board->pst_score[side][phase];
+}
+
 
 /*
  * Pawn evaluation.
@@ -286,17 +480,6 @@ int Evaluator::score_pawns(Color side)
 		sq = pawns.firstbit();
 		pawns.clearbit(sq);
 
-		/* Positional score */
-		const Square idx = (side == WHITE) ? sq
-			: SQUARE(XRANK(RNK(sq)),FIL(sq));
-		if (phase == ENDGAME) {
-			score += pawn_scores_endgame[idx];
-		} else if (phase == MIDGAME) {
-			score += pawn_scores_midgame[idx];
-		} else {
-			score += pawn_scores_opening[idx];
-		}
-
 #ifdef EVAL_PAWNRAMS
 		/* Pawn rams */
 		if (side == myside) {
@@ -359,19 +542,17 @@ int Evaluator::score_knights(Color side)
 {
 	int score = 0;
 
+	need_attacks();
+
 	Square sq;
 	Bitboard knights = board->get_knights(side);
 	while (knights) {
 		sq = knights.firstbit();
 		knights.clearbit(sq);
 
-		/* Positional score */
-		score += knight_scores[sq];
-
 #ifdef EVAL_KNIGHTMOBILITY
 		/* Simple mobility bonus */
-		Bitboard ka = board->knight_attacks(sq)
-				& ~board->get_pieces(side);
+		Bitboard ka = attacks_from[sq] & ~board->get_pieces(side);
 		score += ka.popcnt() * EVAL_KNIGHTMOBILITY;
 #endif
 
@@ -400,6 +581,8 @@ int Evaluator::score_bishops(Color side)
 {
 	int score = 0;
 
+	need_attacks();
+
 	Square sq;
 	Bitboard bishops = board->get_bishops(side);
 	while (bishops) {
@@ -408,8 +591,7 @@ int Evaluator::score_bishops(Color side)
 
 #ifdef EVAL_BISHOPMOBILITY
 		/* Simple mobility bonus */
-		Bitboard ba = board->bishop_attacks(sq)
-				& ~board->get_pieces(side);
+		Bitboard ba = attacks_from[sq] & ~board->get_pieces(side);
 		score += ba.popcnt() * EVAL_BISHOPMOBILITY;
 #endif
 		
@@ -457,6 +639,8 @@ int Evaluator::score_rooks(Color side)
 {
 	int score = 0;
 
+	need_attacks();
+
 	const Color xside = XSIDE(side);
 	const int rank7 = (side == WHITE) ? RANK7 : RANK2;
 	const int rank8 = (side == WHITE) ? RANK8 : RANK1;
@@ -469,8 +653,7 @@ int Evaluator::score_rooks(Color side)
 
 #ifdef EVAL_ROOKMOBILITY
 		/* Simple mobility bonus */
-		Bitboard ra = board->rook_attacks(sq)
-				& ~board->get_pieces(side);
+		Bitboard ra = attacks_from[sq] & ~board->get_pieces(side);
 		score += ra.popcnt() * EVAL_ROOKMOBILITY;
 #endif
 		
@@ -555,6 +738,8 @@ int Evaluator::score_queens(Color side)
 {
 	int score = 0;
 
+	need_attacks();
+
 	Square sq;
 	Bitboard queens = board->get_queens(side);
 	
@@ -571,8 +756,7 @@ int Evaluator::score_queens(Color side)
 		
 #ifdef EVAL_QUEENMOBILITY
 		/* Simple mobility bonus */
-		Bitboard qa = board->queen_attacks(sq)
-				& ~board->get_pieces(side);
+		Bitboard qa = attacks_from[sq] & ~board->get_pieces(side);
 		score += qa.popcnt() * EVAL_QUEENMOBILITY;
 #endif
 		
@@ -607,25 +791,24 @@ int Evaluator::score_king(Color side)
 {
 	int score = 0;
 
-	const Square kingsq = board->get_king(side);
-
-	if (phase == ENDGAME) {
-		score += king_scores_endgame[kingsq];
-	} else {
-		score += king_scores[kingsq];
-	}
-
 #ifdef EVAL_SQAROUNDKINGATKD
-	/* Enemy pieces attacking squares around king */
-	Bitboard attackers = NULLBITBOARD;
-	Bitboard bb = Bitboard::attack_bb[KING][kingsq];
-	while (bb) {
-		Square sq = bb.firstbit();
-		bb.clearbit(sq);
+	need_attacks();
+	const Bitboard zone = Bitboard::attack_bb[KING][board->get_king(side)];
 
-		attackers |= board->attackers(sq, XSIDE(side));
+	/* Enemy pieces attacking squares around king */
+	if (zone & attacks_all[XSIDE(side)]) {
+		Bitboard pieces = board->get_pieces(XSIDE(side));
+		while (pieces) {
+			Square sq = pieces.firstbit();
+			pieces.clearbit(sq);
+
+			if (attacks_from[sq] & zone) {
+				score += EVAL_SQAROUNDKINGATKD;
+			}
+		}
 	}
-	score += attackers.popcnt() * EVAL_SQAROUNDKINGATKD;
+#else
+	(void) side;
 #endif
 
 	return score;
@@ -714,7 +897,10 @@ int Evaluator::score_combo(Color side)
 {
 	int score = 0;
 
-	/* Look for bishop/queen and rook/queen combo. */
+	need_attacks();
+
+	/* Look for bishop/queen and rook/queen combo, i.e. a bishop or
+	 * rook that is attacked by the queen along its own lines. */
 	Bitboard queens = board->get_queens(side);
 	while (queens) {
 		Square q = queens.firstbit();
@@ -722,30 +908,18 @@ int Evaluator::score_combo(Color side)
 
 #ifdef EVAL_QBCOMBO
 		/* bishop/queen */
-		Bitboard bq_bb = board->bishop_attacks(q)
-				& board->get_bishops(side);
-		while (bq_bb) {
-			Square b = bq_bb.firstbit();
-			bq_bb.clearbit(b);
-			
-			if (! (board->get_blocker() & Bitboard::ray_bb[q][b])) {
-				score += EVAL_QBCOMBO;
-			}
-		}
+		Bitboard bq_bb = attacks_from[q]
+			& Bitboard::attack_bb[BISHOP][q]
+			& board->get_bishops(side);
+		score += bq_bb.popcnt() * EVAL_QBCOMBO;
 #endif
 
 #ifdef EVAL_QRCOMBO
 		/* rook/queen */
-		Bitboard rq_bb = board->rook_attacks(q)
-				& board->get_rooks(side);
-		while (rq_bb) {
-			Square r = rq_bb.firstbit();
-			rq_bb.clearbit(r);
-			
-			if (! (board->get_blocker() & Bitboard::ray_bb[q][r])) {
-				score += EVAL_QRCOMBO;
-			}
-		}
+		Bitboard rq_bb = attacks_from[q]
+			& Bitboard::attack_bb[ROOK][q]
+			& board->get_rooks(side);
+		score += rq_bb.popcnt() * EVAL_QRCOMBO;
 #endif
 	}
 
@@ -779,16 +953,69 @@ const unsigned int Evaluator::control_maxattackers[] = {
 	  5,  5,  5,  5,  5,  5,  5,  5
 };
 
-int Evaluator::score_control(Color side)
+Bitboard Evaluator::control_ring[4];
+Bitboard Evaluator::control_cap5;
+Bitboard Evaluator::control_cap6;
+
+/*
+ * Split the tables above into masks: control_ring[k] contains the
+ * squares with control_score > k, and control_cap5/6 the squares where
+ * no more than 5 or 6 attackers are counted.
+ */
+void Evaluator::init_control()
 {
-	int score = 0;
+	for (int k = 0; k < 4; k++) {
+		control_ring[k] = NULLBITBOARD;
+	}
+	control_cap5 = NULLBITBOARD;
+	control_cap6 = NULLBITBOARD;
 
 	for (Square sq = A1; sq <= H8; sq++) {
-		Bitboard attackers = board->attackers(sq, side);
-		unsigned int nr_attackers = attackers.popcnt();
-		
-		score += control_score[sq]
-			* MIN(nr_attackers, control_maxattackers[sq]);
+		ASSERT(control_score[sq] >= 1 && control_score[sq] <= 4);
+		ASSERT(control_maxattackers[sq] >= 5);
+		for (int k = 0; k < control_score[sq]; k++) {
+			control_ring[k].setbit(sq);
+		}
+		if (control_maxattackers[sq] <= 5) {
+			control_cap5.setbit(sq);
+		}
+		if (control_maxattackers[sq] <= 6) {
+			control_cap6.setbit(sq);
+		}
+	}
+}
+
+/*
+ * Sum of control_score[] over the given squares.
+ */
+inline int Evaluator::control_sum(const Bitboard & squares) const
+{
+	return (squares & control_ring[0]).popcnt()
+		+ (squares & control_ring[1]).popcnt()
+		+ (squares & control_ring[2]).popcnt()
+		+ (squares & control_ring[3]).popcnt();
+}
+
+/*
+ * Sum of control_score[sq] * MIN(attackers, control_maxattackers[sq])
+ * over all squares, using the attacker counts from setup(). These count
+ * up to 7 only, which makes a difference only if more than 7 pieces
+ * attack a center square.
+ */
+int Evaluator::score_control(Color side)
+{
+	need_attacks();
+	const Bitboard * count = attack_count[side];
+
+	int score = control_sum(count[0])
+		+ 2 * control_sum(count[1])
+		+ 4 * control_sum(count[2]);
+
+	/* Attackers beyond control_maxattackers[] */
+	const Bitboard over5 = count[2] & count[1];
+	if (over5) {
+		score -= control_sum(over5 & control_cap5)
+			+ control_sum(over5 & count[0] & control_cap6);
 	}
 
 	return score;
@@ -26,6 +26,7 @@
 #include "common.h"
 #include "board.h"
 #include "evalcache.h"
+#include "materialhash.h"
 #include "pawnhash.h"
 
 
@@ -44,27 +45,54 @@ class Evaluator
 		ENDGAME
 	};
 
+	template <int (Evaluator::*)(Color), class> friend struct PluginList;
+
       private:
+	enum { MAX_PLUGINS = 16 };
 	static const struct score_plugin plugins[];
-	static const struct score_plugin plugins2[];
+	unsigned int nr_plugins;
+	/* Sum of the margins of the plugins after plugins[i] */
+	int margin_left[MAX_PLUGINS];
+	/* Position of the first phase 2 plugin in plugins[] */
+	unsigned int phase2_start;
 
       private:
 	PawnHashTable * pawnhashtable;
 	EvaluationCache * evalcache;
+#ifdef USE_MATERIALHASH
+	MaterialHashTable materialhashtable;
+#endif
 
 #ifdef COLLECT_STATISTICS
 	unsigned long stat_evals;
-	unsigned long stat_evals_phase1;
-	unsigned long stat_evals_phase2;
+	unsigned long stat_evals_material;
+	unsigned long stat_evals_cache;
+	unsigned long stat_evals_plugin[MAX_PLUGINS];
 #endif
 
       private:
 	const Board * board;
 	unsigned int phase;
+	int material_score;
 	Color myside;
+#ifdef USE_MATERIALHASH
+	const MaterialHashEntry * matentry;
+#endif
 	PawnHashEntry pawnhashentry;
 	Bitboard passed_pawns[2];
 	//Bitboard pinned_on_king[2];
+
+	/* Attack maps, computed once per evaluation by need_attacks() and
+	 * shared by the plugins: attacks of the piece on each square, of
+	 * each piece type, of a whole side, and squares attacked at least
+	 * twice. attack_count holds the number of attackers of each square
+	 * as bit planes, counting up to 7. */
+	bool attacks_valid;
+	Bitboard attacks_from[64];
+	Bitboard attacks_by[2][6];
+	Bitboard attacks_all[2];
+	Bitboard attacks_double[2];
+	Bitboard attack_count[2][3];
 	
       public:
 	Evaluator();
@@ -82,13 +110,37 @@ class Evaluator
 	void set_param(const std::string& name, const std::string& value);
 	
       private:
+	bool eval_material(const Board & board, int * score);
+	inline int scale_score(int score, Color side) const;
+	inline bool lazy_cutoff(int score, int margin, Color side,
+			int alpha, int beta) const;
+	inline bool phase1_cutoff(int score) const;
+	unsigned int run_plugins(Color side, int * score, int alpha, int beta);
 	void setup(const Board * board);
+	inline void need_attacks();
+	void setup_attacks(Color side);
 	void finish();
 	
       public:
+	static void init();
 	static bool is_draw(const Board & board);
 	static int material_balance(int mat_side, int mat_xside);
 	static unsigned int get_phase(const Board & board);
+      private:
+	static unsigned int get_phase(int material);
+
+#ifdef USE_MATERIALHASH
+	/* Material hash table and endgame recognizers,
+	 * defined in eval_endgame.cc */
+      private:
+	static void init_material_entry(MaterialHashEntry * entry);
+	static int eval_kxk(const Board & board, Color strongside);
+	static int eval_kbnk(const Board & board, Color strongside);
+	static int eval_kpk(const Board & board, Color strongside);
+	static void init_kpk();
+	static bool probe_kpk(Square wk, Square bk, Square p, Color stm);
+	static uint8_t kpk_bitbase[2*24*64*64 / 8];
+#endif
 
       private:
 	static const int pawn_scores_opening[64];
@@ -99,8 +151,15 @@ class Evaluator
 	static const int king_scores_endgame[64];
 	static const int control_score[64];
 	static const unsigned int control_maxattackers[64];
+	static Bitboard control_ring[4];
+	static Bitboard control_cap5;
+	static Bitboard control_cap6;
 
       private:
+	static void init_pst();
+	static void init_control();
+	inline int control_sum(const Bitboard & squares) const;
+	int score_pst(Color side);
 	int score_pawns(Color side);
 	int score_knights(Color side);
 	int score_bishops(Color side);
@@ -112,9 +171,46 @@ class Evaluator
 	int score_control(Color side);
 };
 
+/*
+ * Scale a score from side's point of view according to the material
+ * hash table entry, e.g. an extra minor piece without pawns is worth
+ * nothing.
+ */
+inline int Evaluator::scale_score(int score, Color side) const
+{
+#ifdef USE_MATERIALHASH
+	const Color winner = (score > 0) ? side : XSIDE(side);
+	return score * (int) matentry->scale[winner] / SCALE_NORMAL;
+#else
+	(void) side;
+	return score;
+#endif
+}
+
+/*
+ * Compute the attack maps, unless this has been done already for the
+ * current evaluation. Plugins that use them call this first, so that a
+ * lazy cutoff before them does not pay for the maps.
+ */
+inline void Evaluator::need_attacks()
+{
+	if (!attacks_valid) {
+		setup_attacks(WHITE);
+		setup_attacks(BLACK);
+		attacks_valid = true;
+	}
+}
+
 struct score_plugin {
 	const char * name;
 	int (Evaluator::* func)(Color);
+
+	/* Maximum difference between func(side) and func(xside) */
+	int margin;
+
+	/* Phase 2 plugins are only called if the score of the plugins
+	 * before them is small, see Evaluator::phase1_cutoff() */
+	bool phase2;
 };
 
 #endif // EVAL_H
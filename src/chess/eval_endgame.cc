@@ -0,0 +1,345 @@
+/* $Id$
+ *
+ * HoiChess/chess/eval_endgame.cc
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "eval.h"
+#include "bitboard.h"
+#include "board.h"
+
+#include <string.h>
+
+#ifdef USE_MATERIALHASH
+
+/* Distance between two squares in king moves. */
+static inline int king_distance(Square sq1, Square sq2)
+{
+	return MAX(abs(RNK(sq1)-RNK(sq2)), abs(FIL(sq1)-FIL(sq2)));
+}
+
+/* Distance of a square from the four center squares in king moves. */
+static inline int center_distance(Square sq)
+{
+	return MAX(MAX(3 - FIL(sq), FIL(sq) - 4),
+			MAX(3 - RNK(sq), RNK(sq) - 4));
+}
+
+
+/*****************************************************************************
+ *
+ * Material hash table entries.
+ *
+ *****************************************************************************/
+
+/*
+ * Fill in a material hash table entry from its material signature.
+ */
+void Evaluator::init_material_entry(MaterialHashEntry * e)
+{
+	const uint64_t sig = e->matsig;
+
+	unsigned int cnt[2][6];
+	int mat[2], npm[2];
+	for (int c = WHITE; c <= BLACK; c++) {
+		mat[c] = 0;
+		for (int p = PAWN; p <= KING; p++) {
+			cnt[c][p] = MATSIG_COUNT(sig, c, p);
+			mat[c] += cnt[c][p] * mat_values[p];
+		}
+		npm[c] = mat[c] - cnt[c][PAWN] * mat_values[PAWN];
+	}
+
+	e->balance = material_balance(mat[WHITE], mat[BLACK]);
+	e->phase = get_phase(mat[WHITE] + mat[BLACK]);
+	e->endgame = NULL;
+	e->strongside = WHITE;
+
+	/* Same rules as Board::is_material_draw() */
+	e->draw = true;
+	for (int c = WHITE; c <= BLACK; c++) {
+		if (cnt[c][PAWN] || cnt[c][ROOK] || cnt[c][QUEEN]
+				|| (cnt[c][KNIGHT] + cnt[c][BISHOP] > 1
+				    && !(cnt[c][KNIGHT] == 2
+					    && cnt[c][BISHOP] == 0))) {
+			e->draw = false;
+		}
+	}
+
+	for (int c = WHITE; c <= BLACK; c++) {
+		const int xc = XSIDE(c);
+
+		/*
+		 * Recognized endgames against a bare king.
+		 */
+		if (mat[xc] == 0 && !e->draw) {
+			e->strongside = (Color) c;
+			if (mat[c] == mat_values[PAWN]) {
+				e->endgame = &eval_kpk;
+			} else if (cnt[c][PAWN] > 0) {
+				/* leave it to the normal evaluation */
+			} else if (npm[c] == mat_values[KNIGHT]
+					+ mat_values[BISHOP]
+					&& cnt[c][KNIGHT] == 1) {
+				e->endgame = &eval_kbnk;
+			} else if (npm[c] >= mat_values[ROOK]) {
+				e->endgame = &eval_kxk;
+			}
+		}
+
+		/*
+		 * Without pawns, a side needs more than a minor piece
+		 * advantage to win.
+		 */
+		e->scale[c] = SCALE_NORMAL;
+		if (cnt[c][PAWN] == 0
+				&& npm[c] - npm[xc] <= mat_values[BISHOP]) {
+			if (npm[c] < mat_values[ROOK]) {
+				e->scale[c] = 0;
+			} else if (npm[xc] <= mat_values[BISHOP]) {
+				e->scale[c] = 4;
+			} else {
+				e->scale[c] = 14;
+			}
+		}
+	}
+}
+
+
+/*****************************************************************************
+ *
+ * Endgame evaluation functions. They return the score from strongside's
+ * point of view.
+ *
+ *****************************************************************************/
+
+#define EVAL_KXK_EDGE		20
+#define EVAL_KXK_CLOSE		10
+#define EVAL_KBNK_CORNER	20
+#define EVAL_KPK_WIN		200
+#define EVAL_KPK_RANK		10
+
+/*
+ * Rook, queen, or enough minor pieces against bare king: Drive the
+ * enemy king to the edge, and bring the own king closer.
+ */
+int Evaluator::eval_kxk(const Board & board, Color strongside)
+{
+	const Square sk = board.get_king(strongside);
+	const Square wk = board.get_king(XSIDE(strongside));
+
+	return material_balance(board.get_material(strongside), 0)
+		+ EVAL_KXK_EDGE * center_distance(wk)
+		+ EVAL_KXK_CLOSE * (7 - king_distance(sk, wk));
+}
+
+/*
+ * Bishop and knight against bare king: The enemy king must be driven
+ * into a corner of the bishop's color.
+ */
+int Evaluator::eval_kbnk(const Board & board, Color strongside)
+{
+	const Square sk = board.get_king(strongside);
+	const Square wk = board.get_king(XSIDE(strongside));
+	const Square bsq = board.get_bishops(strongside).firstbit();
+
+	/* A1 is a dark square. */
+	int dist;
+	if ((RNK(bsq) + FIL(bsq)) % 2 == 0) {
+		dist = MIN(king_distance(wk, A1), king_distance(wk, H8));
+	} else {
+		dist = MIN(king_distance(wk, H1), king_distance(wk, A8));
+	}
+
+	return material_balance(board.get_material(strongside), 0)
+		+ EVAL_KBNK_CORNER * (7 - dist)
+		+ EVAL_KXK_CLOSE * (7 - king_distance(sk, wk));
+}
+
+/*
+ * King and pawn against king: Look up the position in the bitbase.
+ */
+int Evaluator::eval_kpk(const Board & board, Color strongside)
+{
+	Square sk = board.get_king(strongside);
+	Square wk = board.get_king(XSIDE(strongside));
+	Square p = board.get_pawns(strongside).firstbit();
+	Color stm = board.get_side();
+
+	/* The bitbase is for white pawns on files A-D only. */
+	if (strongside == BLACK) {
+		sk ^= 56;
+		wk ^= 56;
+		p ^= 56;
+		stm = XSIDE(stm);
+	}
+	if (FIL(p) > FILED) {
+		sk ^= 7;
+		wk ^= 7;
+		p ^= 7;
+	}
+
+	if (!probe_kpk(sk, wk, p, stm)) {
+		return DRAW;
+	}
+
+	return material_balance(mat_values[PAWN], 0)
+		+ EVAL_KPK_WIN + EVAL_KPK_RANK * RNK(p);
+}
+
+
+/*****************************************************************************
+ *
+ * KPK bitbase.
+ *
+ * It contains one bit for each position with white king, black king,
+ * white pawn on files A-D, and side to move, which is set if white wins.
+ * It is generated at startup by retrograde analysis.
+ *
+ *****************************************************************************/
+
+#define KPK_SIZE	(2*24*64*64)
+
+uint8_t Evaluator::kpk_bitbase[KPK_SIZE / 8];
+
+static inline unsigned int kpk_index(Color stm, Square wk, Square bk,
+		Square p)
+{
+	return wk | (bk << 6) | (stm << 12) | (FIL(p) << 13)
+		| ((RANK7 - RNK(p)) << 15);
+}
+
+bool Evaluator::probe_kpk(Square wk, Square bk, Square p, Color stm)
+{
+	ASSERT_DEBUG(FIL(p) <= FILED);
+	ASSERT_DEBUG(RNK(p) >= RANK2 && RNK(p) <= RANK7);
+
+	const unsigned int idx = kpk_index(stm, wk, bk, p);
+	return kpk_bitbase[idx / 8] & (1 << (idx % 8));
+}
+
+enum { KPK_INVALID = 0, KPK_UNKNOWN = 1, KPK_DRAW = 2, KPK_WIN = 4 };
+
+/*
+ * Classify a position from the results of its successors.
+ */
+static uint8_t kpk_classify(const uint8_t * db, Color stm, Square wk,
+		Square bk, Square p)
+{
+	uint8_t r = KPK_INVALID;
+
+	if (stm == WHITE) {
+		Bitboard bb = Bitboard::attack_bb[KING][wk];
+		while (bb) {
+			Square to = bb.firstbit();
+			bb.clearbit(to);
+			r |= db[kpk_index(BLACK, to, bk, p)];
+		}
+
+		if (RNK(p) < RANK7) {
+			r |= db[kpk_index(BLACK, wk, bk, p + 8)];
+		}
+		if (RNK(p) == RANK2 && p + 8 != wk && p + 8 != bk) {
+			r |= db[kpk_index(BLACK, wk, bk, p + 16)];
+		}
+
+		return (r & KPK_WIN) ? KPK_WIN
+			: (r & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_DRAW;
+	} else {
+		Bitboard bb = Bitboard::attack_bb[KING][bk];
+		while (bb) {
+			Square to = bb.firstbit();
+			bb.clearbit(to);
+			r |= db[kpk_index(WHITE, wk, to, p)];
+		}
+
+		return (r & KPK_DRAW) ? KPK_DRAW
+			: (r & KPK_UNKNOWN) ? KPK_UNKNOWN : KPK_WIN;
+	}
+}
+
+void Evaluator::init_kpk()
+{
+	uint8_t * db = new uint8_t[KPK_SIZE];
+
+	/* Positions that can be classified directly */
+	for (unsigned int idx = 0; idx < KPK_SIZE; idx++) {
+		const Square wk = idx & 63;
+		const Square bk = (idx >> 6) & 63;
+		const Color stm = (Color) ((idx >> 12) & 1);
+		const Square p = SQUARE(RANK7 - (idx >> 15), (idx >> 13) & 3);
+
+		const Bitboard wk_atk = Bitboard::attack_bb[KING][wk];
+		const Bitboard bk_atk = Bitboard::attack_bb[KING][bk];
+		const Bitboard p_atk = Bitboard::pawn_capt_bb[WHITE][p];
+
+		if (king_distance(wk, bk) <= 1 || wk == p || bk == p
+				|| (stm == WHITE && p_atk.testbit(bk))) {
+			db[idx] = KPK_INVALID;
+		} else if (stm == WHITE && RNK(p) == RANK7 && wk != p + 8
+				&& (king_distance(bk, p + 8) > 1
+				    || king_distance(wk, p + 8) == 1)) {
+			/* pawn promotes safely */
+			db[idx] = KPK_WIN;
+		} else if (stm == BLACK && !(bk_atk & ~(wk_atk | p_atk))) {
+			/* stalemate */
+			db[idx] = KPK_DRAW;
+		} else if (stm == BLACK && (bk_atk & ~wk_atk).testbit(p)) {
+			/* pawn can be captured */
+			db[idx] = KPK_DRAW;
+		} else {
+			db[idx] = KPK_UNKNOWN;
+		}
+	}
+
+	/* Iterate until no more positions can be classified. */
+	bool changed;
+	do {
+		changed = false;
+		for (unsigned int idx = 0; idx < KPK_SIZE; idx++) {
+			if (db[idx] != KPK_UNKNOWN)
+				continue;
+
+			const Square wk = idx & 63;
+			const Square bk = (idx >> 6) & 63;
+			const Color stm = (Color) ((idx >> 12) & 1);
+			const Square p = SQUARE(RANK7 - (idx >> 15),
+					(idx >> 13) & 3);
+
+			db[idx] = kpk_classify(db, stm, wk, bk, p);
+			if (db[idx] != KPK_UNKNOWN) {
+				changed = true;
+			}
+		}
+	} while (changed);
+
+	/* Remaining unknown positions are draws. */
+	memset(kpk_bitbase, 0, sizeof(kpk_bitbase));
+	for (unsigned int idx = 0; idx < KPK_SIZE; idx++) {
+		if (db[idx] == KPK_WIN) {
+			kpk_bitbase[idx / 8] |= 1 << (idx % 8);
+		}
+	}
+
+	delete[] db;
+}
+
+#endif // USE_MATERIALHASH
@@ -0,0 +1,73 @@
+/* $Id$
+ *
+ * HoiChess/chess/materialhash.cc
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "materialhash.h"
+
+#include <stdio.h>
+
+
+/*****************************************************************************
+ *
+ * Member functions of class MaterialHashTable.
+ *
+ *****************************************************************************/
+
+MaterialHashTable::MaterialHashTable()
+{
+	table = new MaterialHashEntry[1 << MATERIALHASH_BITS];
+
+	/* No real material signature has all bits set, since there
+	 * cannot be more than 10 pieces of a type. */
+	for (unsigned int i = 0; i < (1 << MATERIALHASH_BITS); i++) {
+		table[i].matsig = ~((uint64_t) 0);
+	}
+
+	reset_statistics();
+}
+
+MaterialHashTable::~MaterialHashTable()
+{
+	delete[] table;
+}
+
+void MaterialHashTable::print_statistics(FILE * fp) const
+{
+#ifdef COLLECT_STATISTICS
+	if (stat_probes > 0) {
+		fprintf(fp, "Material hash table probes: %lu, hits: %lu (%lu%%)\n",
+				stat_probes, stat_hits,
+				stat_hits*100/stat_probes);
+	}
+#else
+	(void) fp;
+#endif // COLLECT_STATISTICS
+}
+
+void MaterialHashTable::reset_statistics()
+{
+#ifdef COLLECT_STATISTICS
+	stat_probes = 0;
+	stat_hits = 0;
+#endif // COLLECT_STATISTICS
+}
@@ -0,0 +1,126 @@
+/* $Id$
+ *
+ * HoiChess/chess/materialhash.h
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef MATERIALHASH_H
+#define MATERIALHASH_H
+
+#include "common.h"
+#include "board.h"
+
+#include <stdio.h>
+
+
+/* Scale factor for a normal, i.e. unscaled, score. */
+#define SCALE_NORMAL	64
+
+
+/*****************************************************************************
+ *
+ * Class MaterialHashEntry
+ *
+ * Everything the evaluator can derive from the material signature alone.
+ *
+ *****************************************************************************/
+
+class MaterialHashEntry
+{
+	friend class MaterialHashTable;
+	friend class Evaluator;
+
+      private:
+	uint64_t matsig;
+
+	/* Specialized evaluation function for a recognized endgame,
+	 * or NULL. It returns the score from strongside's point of
+	 * view. */
+	int (* endgame)(const Board & board, Color strongside);
+	Color strongside;
+
+	/* Material balance from white's point of view */
+	int balance;
+	unsigned int phase;
+	bool draw;
+
+	/* Scale factor (out of SCALE_NORMAL) applied to the score if it
+	 * is in favor of the respective side. */
+	unsigned int scale[2];
+};
+
+
+/*****************************************************************************
+ *
+ * Class MaterialHashTable
+ *
+ *****************************************************************************/
+
+class MaterialHashTable
+{
+      private:
+	/* Number of entries is 1 << MATERIALHASH_BITS. There are only few
+	 * different material signatures in a search, so this is small
+	 * enough to stay in the cache. */
+	enum { MATERIALHASH_BITS = 11 };
+
+	MaterialHashEntry * table;
+
+#ifdef COLLECT_STATISTICS
+	unsigned long stat_probes;
+	unsigned long stat_hits;
+#endif // COLLECT_STATISTICS
+
+      public:
+	MaterialHashTable();
+	~MaterialHashTable();
+
+      public:
+	inline MaterialHashEntry * probe(uint64_t matsig, bool * found);
+
+	void print_statistics(FILE * fp = stdout) const;
+	void reset_statistics();
+};
+
+/*
+ * Find the slot for the given material signature. If it does not
+ * contain this signature, *found is set to false, and the caller must
+ * fill in the entry.
+ */
+inline MaterialHashEntry * MaterialHashTable::probe(uint64_t matsig,
+		bool * found)
+{
+	STAT_INC(stat_probes);
+
+	const unsigned int key = (matsig * 0x9e3779b97f4a7c15ULL)
+		>> (64 - MATERIALHASH_BITS);
+	MaterialHashEntry * e = &table[key];
+
+	if (e->matsig == matsig) {
+		STAT_INC(stat_hits);
+		*found = true;
+	} else {
+		e->matsig = matsig;
+		*found = false;
+	}
+
+	return e;
+}
+
+#endif // MATERIALHASH_H
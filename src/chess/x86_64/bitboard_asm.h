@@ -0,0 +1,81 @@
+/* $Id$
+ *
+ * HoiChess/x86_64/bitboard_asm.h
+ *
+ * Copyright (C) 2005 Holger Ruckdeschel <holger@hoicher.de>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+/*
+ * x86-64 assembler version of parallel bit extract (BMI2). This is
+ * written in assembler so that it can be inlined without compiling
+ * the whole program for BMI2. It must only be called if
+ * Bitboard::have_pext() returned true.
+ */
+
+#ifdef USE_ASM_PEXT
+inline uint64_t Bitboard::pext(uint64_t bits, uint64_t mask)
+{
+	uint64_t result;
+	asm("pextq %2, %1, %0"
+		: "=r" (result)
+		: "r" (bits), "rm" (mask));
+
+	return result;
+}
+#endif
+
+/*
+ * x86-64 versions of msb/lsb scan and population count routines.
+ * BSF/BSR are part of the base instruction set, so the compiler
+ * builtins can be used. POPCNT is not, and the builtin would call a
+ * library function unless the program is compiled with -mpopcnt, so
+ * it is written in assembler as well. These must only be called if
+ * Bitboard::have_hw_bitops() returned true.
+ */
+
+#ifdef USE_HW_BITOPS
+inline int Bitboard::hw_lsb(uint64_t bits)
+{
+	if (!bits)
+		return -1;
+	return __builtin_ctzll(bits);
+}
+
+inline int Bitboard::hw_msb(uint64_t bits)
+{
+	if (!bits)
+		return -1;
+	return 63 - __builtin_clzll(bits);
+}
+
+inline int Bitboard::hw_popcnt(uint64_t bits)
+{
+#ifdef __POPCNT__
+	return __builtin_popcountll(bits);
+#else
+	uint64_t result;
+	asm("popcntq %1, %0"
+		: "=r" (result)
+		: "rm" (bits)
+		: "cc");
+
+	return (int) result;
+#endif
+}
+#endif
@@ -32,13 +32,16 @@
 /* Default size of evaluation cache */
 #define DEFAULT_EVALCACHESIZE	"4M"
 
+/* Default memory budget for creating an opening book */
+#define DEFAULT_BOOKMEMSIZE	"64M"
+
 /* Default location of opening book */
 #define DEFAULT_BOOK		"book.dat"
 
 /* Use a single board in search tree, in connection with Board::unmake_move().
  * Otherwise, the board will be copied from node to node each time a move is
- * made. */
-//#define USE_UNMAKE_MOVE
+ * made. Run "bench makemove" to compare both methods. */
+#define USE_UNMAKE_MOVE
 
 /* Use internal iterative deepening */
 #define USE_IID
@@ -52,6 +55,13 @@
 /* Use killer heuristic */
 #define USE_KILLER
 
+/* Use static exchange evaluation to order captures, and to skip losing
+ * captures in quiescence search */
+#define USE_SEE
+
+/* Use late move reductions */
+#define USE_LMR
+
 /* Use null-move pruning */
 #define USE_NULLMOVE
 
@@ -67,6 +77,9 @@
 /* Use evaluation cache */
 #define USE_EVALCACHE
 
+/* Use material hash table and endgame recognizers (HoiChess only) */
+#define USE_MATERIALHASH
+
 /* Search extensions */
 #define EXTEND_IN_CHECK
 #define EXTEND_RECAPTURE
@@ -80,6 +93,9 @@
 /* Maximum size of a Movelist */
 #define MOVELIST_MAXSIZE	256
 
+/* Maximum number of search threads (main thread + helper threads) */
+#define MAXTHREADS		64
+
 /* Collect statistics, e.g. hash table hits, cutoffs during search, etc. */
 #define COLLECT_STATISTICS
 
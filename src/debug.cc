@@ -166,6 +166,7 @@ void debug_print_storagesizes()
 	PRNT(sizeof(Move));
 	PRNT(sizeof(Movelist));
 	PRNT(sizeof(HashEntry));
+	PRNT(HashTable::SIZEOF_ENTRY);
 	PRNT(sizeof(PawnHashEntry));
 	PRNT(EvaluationCache::SIZEOF_ENTRY);
 	PRNT(sizeof(Node));
@@ -9,6 +9,9 @@
 #ifdef DEFAULT_EVALCACHESIZE
 	std::cout << "\tDEFAULT_EVALCACHESIZE " << EXPTOSTRING(DEFAULT_EVALCACHESIZE) << "\n";
 #endif
+#ifdef DEFAULT_BOOKMEMSIZE
+	std::cout << "\tDEFAULT_BOOKMEMSIZE " << EXPTOSTRING(DEFAULT_BOOKMEMSIZE) << "\n";
+#endif
 #ifdef DEFAULT_BOOK
 	std::cout << "\tDEFAULT_BOOK " << EXPTOSTRING(DEFAULT_BOOK) << "\n";
 #endif
@@ -27,6 +30,12 @@
 #ifdef USE_KILLER
 	std::cout << "\tUSE_KILLER " << EXPTOSTRING(USE_KILLER) << "\n";
 #endif
+#ifdef USE_SEE
+	std::cout << "\tUSE_SEE " << EXPTOSTRING(USE_SEE) << "\n";
+#endif
+#ifdef USE_LMR
+	std::cout << "\tUSE_LMR " << EXPTOSTRING(USE_LMR) << "\n";
+#endif
 #ifdef USE_NULLMOVE
 	std::cout << "\tUSE_NULLMOVE " << EXPTOSTRING(USE_NULLMOVE) << "\n";
 #endif
@@ -42,6 +51,9 @@
 #ifdef USE_EVALCACHE
 	std::cout << "\tUSE_EVALCACHE " << EXPTOSTRING(USE_EVALCACHE) << "\n";
 #endif
+#ifdef USE_MATERIALHASH
+	std::cout << "\tUSE_MATERIALHASH " << EXPTOSTRING(USE_MATERIALHASH) << "\n";
+#endif
 #ifdef EXTEND_IN_CHECK
 	std::cout << "\tEXTEND_IN_CHECK " << EXPTOSTRING(EXTEND_IN_CHECK) << "\n";
 #endif
@@ -57,6 +69,9 @@
 #ifdef MOVELIST_MAXSIZE
 	std::cout << "\tMOVELIST_MAXSIZE " << EXPTOSTRING(MOVELIST_MAXSIZE) << "\n";
 #endif
+#ifdef MAXTHREADS
+	std::cout << "\tMAXTHREADS " << EXPTOSTRING(MAXTHREADS) << "\n";
+#endif
 #ifdef COLLECT_STATISTICS
 	std::cout << "\tCOLLECT_STATISTICS " << EXPTOSTRING(COLLECT_STATISTICS) << "\n";
 #endif
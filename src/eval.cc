@@ -23,6 +23,7 @@
 
 #include "common.h"
 #include "eval.h"
+#include "evalplugins.h"
 #include "board.h"
 
 
@@ -30,6 +31,23 @@ Evaluator::Evaluator()
 {
 	pawnhashtable = NULL;
 	evalcache = NULL;
+
+	nr_plugins = 0;
+	while (plugins[nr_plugins].name != NULL) {
+		nr_plugins++;
+	}
+	ASSERT(nr_plugins > 0 && nr_plugins <= MAX_PLUGINS);
+
+	int margin = 0;
+	for (int i=nr_plugins-1; i>=0; i--) {
+		margin_left[i] = margin;
+		margin += plugins[i].margin;
+	}
+
+	phase2_start = 0;
+	while (phase2_start < nr_plugins && !plugins[phase2_start].phase2) {
+		phase2_start++;
+	}
 	
 	reset_statistics();
 }
@@ -51,36 +69,41 @@ Evaluator::~Evaluator()
  *   shown that it depends on available search time.
  */
 #define EVAL_CUTOFF_MATERIAL	150
-#define EVAL_CUTOFF_PHASE1	  5
-#define EVAL_ENABLE_PHASE2
 
+/*
+ * The plugins are called in the order of plugins[], see run_plugins().
+ * After each plugin, the evaluation is stopped if the score cannot get
+ * back into the window [alpha, beta] even if all remaining plugins
+ * contributed their maximum, as given by score_plugin.margin. The margins
+ * are estimates rather than strict maxima, so the partial score is not
+ * returned in that case, only the bound it failed (alpha or beta).
+ * The phase 2 plugins are also skipped if the score is clearly not
+ * balanced, see phase1_cutoff(); that score is returned as it is.
+ */
 int Evaluator::eval(const Board & board, int alpha, int beta, Color _myside)
 {
 	myside = _myside;
 	
 	int score;
 
-	/* TODO is_draw() still empty */
-#if 0
-	if (is_draw(board))
-		return DRAW;
-#endif
-	
 	const Color side = board.get_side();
-	const Color xside = XSIDE(side);
 	STAT_INC(stat_evals);
 
 	
 	/*
-	 * material 
+	 * material, draws by insufficient material and recognized endgames
 	 */
 	
-	score = material_balance(board.get_material(side),
-				 board.get_material(xside));
-	if (score >= beta + EVAL_CUTOFF_MATERIAL
-			|| score <= alpha - EVAL_CUTOFF_MATERIAL) {
+	if (eval_material(board, &score)) {
+		STAT_INC(stat_evals_material);
 		return score;
 	}
+	const int mscore = scale_score(score, side);
+	if (mscore >= beta + EVAL_CUTOFF_MATERIAL
+			|| mscore <= alpha - EVAL_CUTOFF_MATERIAL) {
+		STAT_INC(stat_evals_material);
+		return mscore;
+	}
 	
 	
 	/*
@@ -89,59 +112,25 @@ int Evaluator::eval(const Board & board, int alpha, int beta, Color _myside)
 	
 #ifdef USE_EVALCACHE
 	if (evalcache && evalcache->probe(board, &score)) {
+		STAT_INC(stat_evals_cache);
 		return score;
 	}
 #endif
 	
 	setup(&board);
+	material_score = score;
 
-	
-	/*
-	 * phase 1 
-	 */
-	{
-		STAT_INC(stat_evals_phase1);
-		
-		/* call plugins */
-		int score1 = 0;
-		for (int i=0; plugins[i].name != NULL; i++) {
-			ASSERT_DEBUG(plugins[i].func != NULL);
-			score1 += (this->*plugins[i].func)(side)
-				- (this->*plugins[i].func)(xside);
-		}
-		score += score1;
-#ifdef EVAL_CUTOFF_PHASE1
-		if (score1 > EVAL_CUTOFF_PHASE1
-				|| score1 < -EVAL_CUTOFF_PHASE1) {
-			goto done;
-		}
-#endif
-	}
+	const unsigned int last = run_plugins(side, &score, alpha, beta);
+	STAT_INC(stat_evals_plugin[last]);
 
-#ifdef EVAL_ENABLE_PHASE2
-	/*
-	 * phase 2 
-	 */
-	{
-		STAT_INC(stat_evals_phase2);
-
-		/* call plugins2 */
-		int score2 = 0;
-		for (int i=0; plugins2[i].name != NULL; i++) {
-			ASSERT_DEBUG(plugins2[i].func != NULL);
-			score2 += (this->*plugins2[i].func)(side)
-				- (this->*plugins2[i].func)(xside);
-		}
-		score += score2;
-	}
-#endif
-
-	/*
-	 * done 
-	 */
-	goto done;	// avoid warning about unused label
-done:
 	finish();
+	if (last < nr_plugins - 1 && lazy_cutoff(score, margin_left[last],
+				side, alpha, beta)) {
+		/* Lazy evaluation. Its result depends on alpha and beta,
+		 * so it is not stored in the evaluation cache. */
+		return (scale_score(score, side) >= beta) ? beta : alpha;
+	}
+	score = scale_score(score, side);
 
 #ifdef USE_EVALCACHE
 	if (evalcache) {
@@ -155,6 +144,8 @@ done:
 void Evaluator::print_eval(const Board & board, Color _myside, FILE * fp)
 {
 	myside = _myside;
+	int mscore;
+	const bool mfinal = eval_material(board, &mscore);
 	setup(&board);
 	
 	fprintf(fp, "material: %d/%d\n", 
@@ -164,6 +155,8 @@ void Evaluator::print_eval(const Board & board, Color _myside, FILE * fp)
 	fprintf(fp, "material balance: %d\n",
 			 material_balance(board.material[WHITE],
 				 	  board.material[BLACK]));
+	fprintf(fp, "material score (side to move): %d%s\n", mscore,
+			mfinal ? " (final)" : "");
 	fprintf(fp, "phase: %u\n", phase);
 
 	fprintf(fp, "draw: %s\n", is_draw(board) ? "yes" : "no");
@@ -171,20 +164,13 @@ void Evaluator::print_eval(const Board & board, Color _myside, FILE * fp)
 			(myside == WHITE ? "white"
 		 		: (myside == BLACK ? "black" : "none")));
 
-	fprintf(fp, "scoring plugins:\n");
+	fprintf(fp, "scoring plugins (white/black, margin):\n");
 	for (int i=0; plugins[i].name != NULL; i++) {
 		ASSERT(plugins[i].func != NULL);
-		fprintf(fp, "\t%s: %d/%d\n", plugins[i].name,
+		fprintf(fp, "\t%s: %d/%d, %d\n", plugins[i].name,
 				(this->*plugins[i].func)(WHITE),
-				(this->*plugins[i].func)(BLACK));
-	}
-	
-	fprintf(fp, "scoring plugins2:\n");
-	for (int i=0; plugins2[i].name != NULL; i++) {
-		ASSERT(plugins2[i].func != NULL);
-		fprintf(fp, "\t%s: %d/%d\n", plugins2[i].name,
-				(this->*plugins2[i].func)(WHITE),
-				(this->*plugins2[i].func)(BLACK));
+				(this->*plugins[i].func)(BLACK),
+				plugins[i].margin);
 	}
 }
 
@@ -199,8 +185,11 @@ void Evaluator::reset_statistics()
 {
 #ifdef COLLECT_STATISTICS
 	stat_evals = 0;
-	stat_evals_phase1 = 0;
-	stat_evals_phase2 = 0;
+	stat_evals_material = 0;
+	stat_evals_cache = 0;
+	for (unsigned int i=0; i<MAX_PLUGINS; i++) {
+		stat_evals_plugin[i] = 0;
+	}
 #endif
 
 	if (pawnhashtable) {
@@ -212,13 +201,27 @@ void Evaluator::reset_statistics()
 		evalcache->reset_statistics();
 	}
 #endif
+
+#if defined(HOICHESS) && defined(USE_MATERIALHASH)
+	materialhashtable.reset_statistics();
+#endif
 }
 
 void Evaluator::print_statistics(FILE * fp) const
 {
 #ifdef COLLECT_STATISTICS
-	fprintf(fp, "Evaluations: %lu/%lu/%lu\n",
-			stat_evals, stat_evals_phase1, stat_evals_phase2);
+	fprintf(fp, "Evaluations: %lu\n", stat_evals);
+	if (stat_evals > 0) {
+		/* Fraction of evaluations that ended at each stage */
+		fprintf(fp, "Evaluation stages: material %lu%%, cache %lu%%",
+				stat_evals_material*100/stat_evals,
+				stat_evals_cache*100/stat_evals);
+		for (unsigned int i=0; i<nr_plugins; i++) {
+			fprintf(fp, ", %s %lu%%", plugins[i].name,
+					stat_evals_plugin[i]*100/stat_evals);
+		}
+		fprintf(fp, "\n");
+	}
 #endif // COLLECT_STATISTICS
 
 	if (pawnhashtable) {
@@ -230,6 +233,10 @@ void Evaluator::print_statistics(FILE * fp) const
 		evalcache->print_statistics(fp);
 	}
 #endif
+
+#if defined(HOICHESS) && defined(USE_MATERIALHASH)
+	materialhashtable.print_statistics(fp);
+#endif
 }
 
 
@@ -24,17 +24,14 @@
 #include "common.h"
 #include "evalcache.h"
 
-#include <limits.h>
 
 EvaluationCache::EvaluationCache(unsigned long size)
 {
 	ASSERT(size > 0);
 
 	cache_size = size;
-	cache = new struct cacheentry[cache_size];
-	for (unsigned long i = 0; i < cache_size; i++) {
-		cache[i].score = INT_MIN;
-	}
+	cache_mem = new LargeMemory(cache_size * sizeof(struct cacheentry));
+	cache = (struct cacheentry *) cache_mem->get();
 	entries = 0;
 
 	reset_statistics();
@@ -42,16 +39,12 @@ EvaluationCache::EvaluationCache(unsigned long size)
 
 EvaluationCache::~EvaluationCache()
 {
-	delete[] cache;
+	delete cache_mem;
 }
 
 void EvaluationCache::clear()
 {
-	delete[] cache;
-	cache = new struct cacheentry[cache_size];
-	for (unsigned long i = 0; i < cache_size; i++) {
-		cache[i].score = INT_MIN;
-	}
+	cache_mem->clear();
 	entries = 0;
 
 	reset_statistics();
@@ -62,8 +55,12 @@ bool EvaluationCache::put(const Board & board, int score)
 	const Hashkey hashkey = board.get_hashkey_noside();
 	const unsigned long key = hashkey % cache_size;
 
+	if (hashkey == 0) {
+		return false;
+	}
+
 	/* We use an always replace strategy. */
-	if (cache[key].score == INT_MIN) {
+	if (cache[key].hashkey == 0) {
 		entries++;
 	} else if (cache[key].hashkey != hashkey) {
 		STAT_INC(stat_collisions);
@@ -82,9 +79,7 @@ bool EvaluationCache::probe(const Board & board, int * score)
 	const Hashkey hashkey = board.get_hashkey_noside();
 	const unsigned long key = hashkey % cache_size;
 
-	if (cache[key].score == INT_MIN) {
-		return false;
-	} else if (cache[key].hashkey != hashkey) {
+	if (hashkey == 0 || cache[key].hashkey != hashkey) {
 		return false;
 	}
 
@@ -102,6 +97,7 @@ void EvaluationCache::print_info(FILE * fp) const
 	fprintf(fp, "Evaluation cache usage: %lu entries (%lu%%)\n",
 			entries,
 			entries*100/cache_size);
+	cache_mem->print_info("Evaluation cache", fp);
 }
 
 void EvaluationCache::print_statistics(FILE * fp) const
@@ -24,6 +24,7 @@
 #define EVALCACHE_H
 
 #include "board.h"
+#include "largemem.h"
 
 
 /*****************************************************************************
@@ -35,7 +36,8 @@
 class EvaluationCache
 {
       private:
-	/* A cache slot is empty if score == INT_MIN. */
+	/* A cache slot is empty if hashkey == 0, so that zeroed memory is
+	 * an empty cache. Positions with hashkey 0 are never stored. */
 	struct cacheentry {
 		Hashkey hashkey;
 		int score;
@@ -46,6 +48,7 @@ class EvaluationCache
       
       private:
 	unsigned long cache_size;
+	LargeMemory * cache_mem;
 	struct cacheentry * cache;
 	
 	unsigned long entries;
@@ -64,6 +67,8 @@ class EvaluationCache
 	void clear();
 	bool put(const Board & board, int score);
 	bool probe(const Board & board, int * score);	
+	unsigned long get_size() const
+	{ return cache_size; }
 
 	void print_info(FILE * fp = stdout) const;
 	void print_statistics(FILE * fp = stdout) const;
@@ -0,0 +1,131 @@
+/* $Id$
+ *
+ * HoiChess/evalplugins.h
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef EVALPLUGINS_H
+#define EVALPLUGINS_H
+
+#include "common.h"
+#include "eval.h"
+
+
+/*****************************************************************************
+ *
+ * Compile-time list of scoring plugins
+ *
+ * Evaluator::run_plugins() of each game expands a chain of PluginList
+ * types, ending with PluginListEnd, for the side to move. This way all
+ * plugin calls are direct calls with a constant side, which the compiler
+ * can inline, instead of calls through member function pointers.
+ *
+ * Evaluator::plugins[] remains the named list with the margins, for
+ * print_eval() and the statistics. Both lists must be in the same order,
+ * which is checked by matches().
+ *
+ *****************************************************************************/
+
+struct PluginListEnd
+{
+	enum { SIZE = 0 };
+
+	template <Color side, unsigned int stage>
+	static inline unsigned int run(Evaluator * e, int * score,
+			int alpha, int beta)
+	{
+		(void) e;
+		(void) score;
+		(void) alpha;
+		(void) beta;
+		return stage - 1;
+	}
+
+	static bool matches(const struct score_plugin * p)
+	{
+		return p->name == NULL;
+	}
+};
+
+template <int (Evaluator::* F)(Color), class Next>
+struct PluginList
+{
+	enum { SIZE = Next::SIZE + 1 };
+
+	/*
+	 * Call the plugin at position stage in plugins[] for both sides,
+	 * then continue with the next one, unless the score is already
+	 * known to be outside [alpha, beta], or the next one is the first
+	 * phase 2 plugin and the score is not small enough for it. Returns
+	 * the position of the last plugin that was called.
+	 */
+	template <Color side, unsigned int stage>
+	static inline unsigned int run(Evaluator * e, int * score,
+			int alpha, int beta)
+	{
+		*score += (e->*F)(side) - (e->*F)(XSIDE(side));
+
+		if (Next::SIZE > 0 && e->lazy_cutoff(*score,
+					e->margin_left[stage], side,
+					alpha, beta)) {
+			return stage;
+		}
+		if (Next::SIZE > 0 && stage + 1 == e->phase2_start
+				&& e->phase1_cutoff(*score)) {
+			return stage;
+		}
+
+		return Next::template run<side, stage + 1>(e, score,
+				alpha, beta);
+	}
+
+	static bool matches(const struct score_plugin * p)
+	{
+		return p->func == F && Next::matches(p + 1);
+	}
+};
+
+
+/*
+ * Returns true if score cannot get back into [alpha, beta], even if the
+ * remaining plugins add or subtract up to margin. Scaling keeps the order
+ * of scores, so the bounds can be scaled instead of the score itself.
+ */
+inline bool Evaluator::lazy_cutoff(int score, int margin, Color side,
+		int alpha, int beta) const
+{
+	return scale_score(score - margin, side) >= beta
+		|| scale_score(score + margin, side) <= alpha;
+}
+
+/*
+ * The phase 2 plugins are expensive and matter only in balanced positions.
+ * They are skipped if the positional score of the phase 1 plugins, i.e.
+ * without material, is larger than EVAL_CUTOFF_PHASE1. Unlike a lazy
+ * cutoff this does not depend on alpha and beta, so the score is exact.
+ */
+#define EVAL_CUTOFF_PHASE1	5
+
+inline bool Evaluator::phase1_cutoff(int score) const
+{
+	const int pscore = score - material_score;
+	return pscore > EVAL_CUTOFF_PHASE1 || pscore < -EVAL_CUTOFF_PHASE1;
+}
+
+#endif // EVALPLUGINS_H
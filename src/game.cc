@@ -471,15 +471,24 @@ void Game::print(FILE * fp) const
 	}
 }
 
-void Game::write_pgn(FILE * fp) const
+/*
+ * Write the game in PGN format. The names of the players and the round are
+ * unknown unless given.
+ */
+void Game::write_pgn(FILE * fp, const char * white, const char * black,
+		unsigned int round) const
 {
 	/* standard tags (seven tag roster) */
 	fprintf(fp, "[Event \"unknown\"]\n");
 	fprintf(fp, "[Site \"unknown\"]\n");
 	fprintf(fp, "[Date \"unknown\"]\n");
-	fprintf(fp, "[Round \"unknown\"]\n");
-	fprintf(fp, "[White \"unknown\"]\n");
-	fprintf(fp, "[Black \"unknown\"]\n");
+	if (round > 0) {
+		fprintf(fp, "[Round \"%u\"]\n", round);
+	} else {
+		fprintf(fp, "[Round \"unknown\"]\n");
+	}
+	fprintf(fp, "[White \"%s\"]\n", white ? white : "unknown");
+	fprintf(fp, "[Black \"%s\"]\n", black ? black : "unknown");
 	fprintf(fp, "[Result \"%s\"]\n", get_result_str().c_str());
 
 	/* additional tag: FEN if non-standard starting position */
@@ -501,6 +510,10 @@ void Game::write_pgn(FILE * fp) const
 
 		if (it->get_board().get_side() == WHITE) {
 			nchars += fprintf(fp, "%d. %s ", i, s.c_str());
+		} else if (it == entries.begin()) {
+			/* Black moves first in the starting position */
+			nchars += fprintf(fp, "%d... %s ", i, s.c_str());
+			i++;
 		} else {
 			nchars += fprintf(fp, "%s ", s.c_str());
 			i++;
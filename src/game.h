@@ -148,7 +148,8 @@ class Game
 
       public:
 	void print(FILE * fp = stdout) const;
-	void write_pgn(FILE * fp = stdout) const;
+	void write_pgn(FILE * fp = stdout, const char * white = NULL,
+			const char * black = NULL, unsigned int round = 0) const;
 };
 
 #endif // GAME_H
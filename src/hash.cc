@@ -26,7 +26,13 @@
 #include "hash.h"
 #include "move.h"
 
+#include <limits.h>
 #include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_MMAP
+# include <unistd.h>
+#endif
 
 
 /*****************************************************************************
@@ -57,57 +63,287 @@ HashTable::HashTable(unsigned long size)
 {
 	ASSERT(size > 0);
 
-	table_size = size;
-	table = new HashEntry[table_size];
+	/* lock() reads the slot as 32-bit words. */
+	ASSERT(sizeof(struct slot) % sizeof(uint32_t) == 0);
+	ASSERT(BUCKET_SLOTS > 0);
+
+	nr_buckets = get_nr_buckets(size);
+	table_size = nr_buckets * BUCKET_SLOTS;
+
+	/* LargeMemory aligns buckets to cache lines, and is zeroed. */
+	table_mem = new LargeMemory(nr_buckets * sizeof(struct bucket));
+	table = (struct bucket *) table_mem->get();
+	header = NULL;
+	readonly = false;
+
+	replacement_scheme = REPL_ALWAYS;
+
 	entries = 0;
+	age = 0;
+	reset_statistics();
+}
+
+/*
+ * Use a table in the POSIX shared memory object shm_name, together with
+ * other processes. If the object does not exist yet, it is created with
+ * room for size entries, otherwise the existing table is used with its
+ * own size. A read-only table, e.g. one that has been filled by an
+ * earlier analysis, is only probed and never modified.
+ *
+ * Throws HashTableException if the table cannot be used.
+ */
+HashTable::HashTable(unsigned long size, const char * shm_name,
+		bool readonly)
+{
+	ASSERT(size > 0);
+	ASSERT(sizeof(struct slot) % sizeof(uint32_t) == 0);
+	ASSERT(BUCKET_SLOTS > 0);
+	ASSERT(sizeof(struct shm_header) <= sizeof(struct bucket));
+
+	nr_buckets = get_nr_buckets(size);
+
+	/* The header takes the first bucket. */
+	std::string error;
+	table_mem = LargeMemory::open_shared(shm_name,
+			(nr_buckets + 1) * sizeof(struct bucket),
+			readonly, &error);
+	if (!table_mem) {
+		throw HashTableException(error);
+	}
+	header = (struct shm_header *) table_mem->get();
+	table = (struct bucket *) table_mem->get() + 1;
+	this->shm_name = shm_name;
+	this->readonly = readonly;
+
+	if (table_mem->is_created()) {
+		header->version = SHM_VERSION;
+		header->slot_size = sizeof(struct slot);
+		header->bucket_size = sizeof(struct bucket);
+		header->nr_buckets = nr_buckets;
+		header->age = 0;
+
+		/* Other processes may use the table as soon as
+		 * they see the magic number. */
+		__sync_synchronize();
+		header->magic = SHM_MAGIC;
+	} else {
+		attach_shared();
+	}
+	table_size = nr_buckets * BUCKET_SLOTS;
 
 	replacement_scheme = REPL_ALWAYS;
-	
+
+	entries = table_mem->is_created() ? 0 : count_entries();
+	age = header->age;
 	reset_statistics();
 }
 
 HashTable::~HashTable()
 {
-	delete[] table;
+	delete table_mem;
+}
+
+/*
+ * Use the largest power of two number of buckets that fits into size
+ * entries, so that the bucket index can be computed with a mask instead
+ * of a modulo.
+ */
+unsigned long HashTable::get_nr_buckets(unsigned long size)
+{
+	unsigned long n = 1;
+	while (n * 2 * BUCKET_SLOTS <= size) {
+		n *= 2;
+	}
+	return n;
+}
+
+/*
+ * Check the header of an existing shared table, written by another
+ * process, and take the table size from it.
+ */
+void HashTable::attach_shared()
+{
+	/* The creator might not have finished the header yet. */
+#ifdef HAVE_MMAP
+	volatile uint32_t * magic = &header->magic;
+	for (unsigned int i = 0; *magic == 0 && i < 100; i++) {
+		usleep(10000);
+	}
+#endif
+	__sync_synchronize();
+
+	std::string msg;
+	if (header->magic != SHM_MAGIC) {
+		msg = strprintf("%s seems to be no hash table of this engine"
+				" (magic = 0x%08lx, should be 0x%08lx)\n",
+				shm_name.c_str(),
+				(unsigned long) header->magic,
+				(unsigned long) SHM_MAGIC);
+	} else if (header->version != SHM_VERSION
+			|| header->slot_size != sizeof(struct slot)
+			|| header->bucket_size != sizeof(struct bucket)) {
+		msg = strprintf("%s has an incompatible layout"
+				" (version %u, %u/%u bytes per entry/bucket,"
+				" should be version %u, %u/%u bytes)\n",
+				shm_name.c_str(),
+				header->version, header->slot_size,
+				header->bucket_size, SHM_VERSION,
+				(unsigned int) sizeof(struct slot),
+				(unsigned int) sizeof(struct bucket));
+	} else if (header->nr_buckets == 0
+			|| (header->nr_buckets & (header->nr_buckets - 1))
+			|| (header->nr_buckets + 1) * sizeof(struct bucket)
+				> table_mem->get_size()) {
+		msg = strprintf("%s has an invalid size (%lu buckets)\n",
+				shm_name.c_str(),
+				(unsigned long) header->nr_buckets);
+	}
+
+	if (!msg.empty()) {
+		delete table_mem;
+		throw HashTableException(msg);
+	}
+
+	nr_buckets = header->nr_buckets;
+}
+
+/*
+ * Count the used slots, for a shared table that has been filled by
+ * other processes.
+ */
+unsigned long HashTable::count_entries() const
+{
+	unsigned long n = 0;
+	for (unsigned long i = 0; i < nr_buckets; i++) {
+		for (unsigned int j = 0; j < BUCKET_SLOTS; j++) {
+			if (table[i].slots[j].type != HashEntry::NONE) {
+				n++;
+			}
+		}
+	}
+	return n;
 }
 
+/*
+ * Clear the table. A shared table is cleared for all processes, but a
+ * read-only one is kept as it is.
+ */
 void HashTable::clear()
 {
-	delete[] table;
-	table = new HashEntry[table_size];
+	if (readonly) {
+		reset_statistics();
+		return;
+	}
+
+	if (header) {
+		table_mem->clear(sizeof(struct bucket));
+	} else {
+		table_mem->clear();
+		age = 0;
+	}
 	entries = 0;
 
 	reset_statistics();
 }
 
+/*
+ * Start a new search. Entries stored by previous searches are
+ * considered stale and will be replaced first. The generation of a
+ * shared table is counted by all processes together; an increment
+ * that is lost to a concurrent one does no harm.
+ */
+void HashTable::new_search()
+{
+	if (!header) {
+		age++;
+	} else if (!readonly) {
+		age = ++header->age;
+	} else {
+		age = header->age;
+	}
+}
+
+/* Slots are read and written without locking. Every slot is copied to
+ * a private buffer before it is examined, and a slot that was torn by
+ * concurrent writes does not pass the lock() check. The entry counter
+ * and statistics are updated non-atomically, so they are only
+ * approximate when several threads share the table.
+ *
+ * When the position is not yet in the bucket, the slot to replace is
+ * chosen by preferring empty slots, then slots from older searches,
+ * then shallow slots. With REPL_ALWAYS the new entry is always stored,
+ * with REPL_DEPTH only if it is at least as deep as the slot it would
+ * replace, where each search generation the slot is old counts as
+ * 8 plies. */
 bool HashTable::put(const HashEntry & entry)
 {
-	const unsigned long key = entry.hashkey % table_size;
-	const HashEntry & e = table[key];
+	if (readonly) {
+		return false;
+	}
 
-	if (e.type == HashEntry::NONE) {
-		entries++;
-	} else {
-		switch (replacement_scheme) {
-		case REPL_ALWAYS:
-			/* Always replace. */
-			break;
-		case REPL_DEPTH:
-			/* Replace when same depth or deeper. */
-			if (e.depth > entry.depth) {
-				return false;
+	const Hashkey hashkey = entry.hashkey;
+	struct bucket * b = &table[hashkey & (nr_buckets - 1)];
+
+	struct slot s;
+	struct slot * victim = NULL;
+	int victim_worth = INT_MAX;
+	bool victim_same = false;
+
+	for (unsigned int i = 0; i < BUCKET_SLOTS; i++) {
+		memcpy((void *) &s, &b->slots[i], sizeof(struct slot));
+
+		if (s.type == HashEntry::NONE) {
+			if (victim_worth > INT_MIN) {
+				victim = &b->slots[i];
+				victim_worth = INT_MIN;
 			}
+			continue;
+		}
+
+		if (s.lock == lock(s, hashkey)) {
+			victim = &b->slots[i];
+			victim_worth = s.age == age ? s.depth : INT_MIN;
+			victim_same = true;
 			break;
-		default:
-			BUG("replacement_scheme = %d", replacement_scheme);
 		}
 
-		if (e.hashkey != entry.hashkey) {
-			STAT_INC(stat_collisions);
+		/* Each search generation counts as much as 8 plies. */
+		const int worth = s.depth - 8 * (uint8_t) (age - s.age);
+		if (worth < victim_worth) {
+			victim = &b->slots[i];
+			victim_worth = worth;
 		}
 	}
+	ASSERT(victim != NULL);
 
-	table[key] = entry;
+	switch (replacement_scheme) {
+	case REPL_ALWAYS:
+		/* Always replace. */
+		break;
+	case REPL_DEPTH:
+		/* Replace when same depth or deeper. */
+		if (victim_worth > (int) entry.depth) {
+			return false;
+		}
+		break;
+	default:
+		BUG("replacement_scheme = %d", replacement_scheme);
+	}
+
+	if (victim_worth == INT_MIN && !victim_same) {
+		entries++;
+	} else if (!victim_same) {
+		STAT_INC(stat_collisions);
+	}
+
+	memset((void *) &s, 0, sizeof(struct slot));
+	s.type = entry.type;
+	s.age = age;
+	s.depth = entry.depth;
+	s.score = entry.score;
+	s.move = entry.move;
+	s.lock = lock(s, hashkey);
+	memcpy((void *) victim, &s, sizeof(struct slot));
 	return true;
 }
 
@@ -115,28 +351,47 @@ bool HashTable::probe(const Board & board, HashEntry * entry)
 {
 	STAT_INC(stat_probes);
 
-	const unsigned long key = board.get_hashkey() % table_size;
-	const HashEntry & e = table[key];
-	
-	if (e.type == HashEntry::NONE || e.hashkey != board.get_hashkey()) {
+	const Hashkey hashkey = board.get_hashkey();
+	struct bucket * b = &table[hashkey & (nr_buckets - 1)];
+
+	struct slot s;
+	unsigned int i;
+	for (i = 0; i < BUCKET_SLOTS; i++) {
+		memcpy((void *) &s, &b->slots[i], sizeof(struct slot));
+		if (s.type != HashEntry::NONE && s.lock == lock(s, hashkey)) {
+			break;
+		}
+	}
+	if (i == BUCKET_SLOTS) {
 		return false;
 	}
 
 	/* If this entry has a move, make sure it is
 	 * valid for the given board position. */
-	if (e.move) {
-		if (!e.move.is_valid(board)) {
+	if (s.move) {
+		if (!s.move.is_valid(board)) {
 			STAT_INC(stat_collisions2);
 			return false;
 		}
 
-		if (!e.move.is_legal(board)) {
+		if (!s.move.is_legal(board)) {
 			WARN("illegal move in hash table");
 			return false;
 		}
 	}
+
+	/* Entry is still useful, so it is no longer stale. */
+	if (s.age != age && !readonly) {
+		s.age = age;
+		s.lock = lock(s, hashkey);
+		memcpy((void *) &b->slots[i], &s, sizeof(struct slot));
+	}
 	
-	*entry = e;
+	entry->hashkey = hashkey;
+	entry->type = s.type;
+	entry->depth = s.depth;
+	entry->score = s.score;
+	entry->move = s.move;
 	STAT_INC(stat_hits);
 	return true;
 }
@@ -160,9 +415,11 @@ void HashTable::set_replacement_scheme(const std::string & scheme)
 
 void HashTable::print_info(FILE * fp) const
 {
-	fprintf(fp, "Hash table size: %lu entries (%.1f MiB)\n",
+	fprintf(fp, "Hash table size: %lu entries (%.1f MiB), "
+			"%lu buckets of %u entries\n",
 			table_size,
-			(float) table_size * sizeof(HashEntry) / (1<<20));
+			(float) table_size * SIZEOF_ENTRY / (1<<20),
+			nr_buckets, BUCKET_SLOTS);
 	fprintf(fp, "Hash table usage: %lu entries (%lu%%)\n",
 			entries,
 			entries*100/table_size);
@@ -179,6 +436,14 @@ void HashTable::print_info(FILE * fp) const
 		BUG("replacement_scheme = %d", replacement_scheme);
 	}
 	fprintf(fp, "Hash table replacement scheme: %s\n", s);
+	if (header) {
+		fprintf(fp, "Hash table shared memory: %s (%s, %s)\n",
+				shm_name.c_str(),
+				readonly ? "read-only" : "read-write",
+				table_mem->is_created() ? "created"
+					: "attached");
+	}
+	table_mem->print_info("Hash table", fp);
 }
 
 void HashTable::print_statistics(FILE * fp) const
@@ -25,9 +25,14 @@
 
 #include "common.h"
 #include "board.h"
+#include "largemem.h"
 #include "move.h"
 #include "util.h"
 
+#include <string.h>
+
+#include <string>
+
 
 typedef uint64_t Hashkey;
 #define NULLHASHKEY	((uint64_t) 0)
@@ -93,21 +98,89 @@ inline Move HashEntry::get_move() const
 
 /*****************************************************************************
  *
- * Class HashEntry
+ * Class HashTable
  *
  *****************************************************************************/
 
+class HashTableException {
+	std::string msg; 
+
+      public:
+	HashTableException(const std::string& msg) : msg(msg)
+	{}
+
+      public:
+	const std::string& get_msg() {
+		return msg;
+	}
+};
+
 class HashTable
 {
       public:
 	enum replacement_schemes { REPL_ALWAYS, REPL_DEPTH };
 
       private:
-	unsigned long table_size;
-	HashEntry * table;
+	/* Compact representation of a HashEntry inside the table. Only
+	 * the upper 32 bits of the hash key are stored, the lower bits
+	 * select the bucket. The stored key is XOR'ed with the data
+	 * words of the slot, see lock(). */
+	struct slot {
+		uint32_t lock;
+		uint8_t type;
+		uint8_t age;
+		uint16_t depth;
+		int32_t score;
+		Move move;
+	};
+
+	/* Slots are grouped into buckets of one cache line each. */
+	static const size_t BUCKET_SIZE = 64;
+	static const unsigned int BUCKET_SLOTS
+		= BUCKET_SIZE / sizeof(struct slot);
+
+	struct bucket {
+		struct slot slots[BUCKET_SLOTS];
+	};
+
+	/* A table in shared memory starts with this header, which takes
+	 * one bucket. Processes that attach to an existing table check
+	 * that it has the same layout. The search generation is shared
+	 * as well, so that all processes age the entries alike. */
+	struct shm_header {
+		uint32_t magic;		/* written last by the creator */
+		uint32_t version;
+		uint32_t slot_size;
+		uint32_t bucket_size;
+		uint64_t nr_buckets;
+		uint8_t age;
+	};
+
+#if defined(HOICHESS)
+	static const uint32_t SHM_MAGIC = 0x6ec4a5b1L;
+#elif defined(HOIXIANGQI)
+	static const uint32_t SHM_MAGIC = 0x3d9e0c27L;
+#else
+# error "neither HOICHESS nor HOIXIANGQI defined"
+#endif
+	/* Increase when the meaning of the slot contents changes. */
+	static const uint32_t SHM_VERSION = 1;
+
+      public:
+	static const size_t SIZEOF_ENTRY = sizeof(struct slot);
+
+      private:
+	unsigned long nr_buckets;	/* always a power of two */
+	unsigned long table_size;	/* number of slots */
+	LargeMemory * table_mem;
+	struct bucket * table;
+	struct shm_header * header;	/* NULL if not shared */
+	std::string shm_name;
+	bool readonly;
 
 	unsigned long entries;
 	enum replacement_schemes replacement_scheme;
+	uint8_t age;
 	
 #ifdef COLLECT_STATISTICS
 	unsigned long stat_probes;
@@ -119,10 +192,12 @@ class HashTable
 
       public:
 	HashTable(unsigned long size);
+	HashTable(unsigned long size, const char * shm_name, bool readonly);
 	~HashTable();
 
       public:
 	void clear();
+	void new_search();
 	bool put(const HashEntry & entry);
 	bool probe(const Board & board, HashEntry * entry);	
 	inline void incr_hits2();
@@ -132,6 +207,12 @@ class HashTable
 	void print_info(FILE * fp = stdout) const;
 	void print_statistics(FILE * fp = stdout) const;
 	void reset_statistics();
+
+      private:
+	static unsigned long get_nr_buckets(unsigned long size);
+	void attach_shared();
+	unsigned long count_entries() const;
+	inline static uint32_t lock(const struct slot & s, Hashkey hashkey);
 };
 
 inline void HashTable::incr_hits2()
@@ -139,4 +220,23 @@ inline void HashTable::incr_hits2()
 	STAT_INC(stat_hits2);
 }
 
+/* Upper half of the hash key, XOR'ed with all 32-bit data words of the
+ * slot. Slots are read and written without locking, so a slot that was
+ * torn by concurrent writers fails this check and is treated as empty.
+ * The words are read with memcpy() so that this works for any Move
+ * layout. */
+inline uint32_t HashTable::lock(const struct slot & s, Hashkey hashkey)
+{
+	const unsigned int nwords = sizeof(struct slot) / sizeof(uint32_t) - 1;
+	uint32_t words[nwords];
+	memcpy(words, reinterpret_cast<const char *>(&s) + sizeof(uint32_t),
+			sizeof(words));
+
+	uint32_t x = (uint32_t) (hashkey >> 32);
+	for (unsigned int i = 0; i < nwords; i++) {
+		x ^= words[i];
+	}
+	return x;
+}
+
 #endif // HASH_H
@@ -24,6 +24,7 @@
 #include "common.h"
 #include "basic.h"
 #include "board.h"
+#include "eval.h"
 
 #include <time.h>
 
@@ -42,6 +43,7 @@ void init()
 	Bitboard::init();
 #endif
 	Board::init();
+	Evaluator::init();
 
 	srand(time(NULL));
 
@@ -0,0 +1,400 @@
+/* $Id$
+ *
+ * HoiChess/largemem.cc
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "largemem.h"
+#include "thread.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#ifdef HAVE_MMAP
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+#if defined(HAVE_MMAP) && defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+# ifndef MAP_HUGE_2MB
+#  define MAP_HUGE_2MB	(21 << MAP_HUGE_SHIFT)
+# endif
+# ifndef MAP_HUGE_1GB
+#  define MAP_HUGE_1GB	(30 << MAP_HUGE_SHIFT)
+# endif
+#endif
+
+#define SIZE_2M		((size_t) 1 << 21)
+#define SIZE_1G		((size_t) 1 << 30)
+
+/* Tables smaller than this are cleared by the calling thread alone. */
+#define PARALLEL_CLEAR_MIN	((size_t) 64 << 20)
+
+
+LargeMemory::LargeMemory(size_t size)
+{
+	ASSERT(size > 0);
+	this->size = size;
+	mem = NULL;
+	shared = false;
+	created = false;
+	readonly = false;
+
+#ifdef HAVE_MMAP
+# if defined(MAP_HUGETLB) && defined(MAP_HUGE_SHIFT)
+	if (size >= SIZE_1G && map((size + SIZE_1G - 1) & ~(SIZE_1G - 1),
+				MAP_HUGETLB | MAP_HUGE_1GB,
+				PAGES_HUGETLB_1G)) {
+		/* ok */
+	} else if (size >= SIZE_2M && map((size + SIZE_2M - 1)
+				& ~(SIZE_2M - 1),
+				MAP_HUGETLB | MAP_HUGE_2MB,
+				PAGES_HUGETLB_2M)) {
+		/* ok */
+	} else
+# endif
+	if (map(size >= SIZE_2M ? (size + SIZE_2M - 1) & ~(SIZE_2M - 1)
+				: size, 0, PAGES_NORMAL)) {
+		/* Transparent huge pages only cover aligned 2 MiB blocks,
+		 * so map() has aligned the memory. */
+# ifdef MADV_HUGEPAGE
+		if (size >= SIZE_2M && madvise(mem, mapped_size,
+					MADV_HUGEPAGE) == 0) {
+			pages = PAGES_TRANSPARENT;
+		}
+# endif
+	}
+#endif // HAVE_MMAP
+
+	if (mem == NULL) {
+		mapped_size = 0;
+		pages = PAGES_NORMAL;
+		mem = new char[size + 63];
+	}
+
+	clear();
+}
+
+LargeMemory::LargeMemory()
+{
+	mem = NULL;
+	size = 0;
+	mapped_size = 0;
+	pages = PAGES_NORMAL;
+	shared = false;
+	created = false;
+	readonly = false;
+}
+
+LargeMemory::~LargeMemory()
+{
+#ifdef HAVE_MMAP
+	if (mapped_size > 0) {
+		munmap(mem, mapped_size);
+		return;
+	}
+#endif
+	delete[] mem;
+}
+
+/*
+ * Try to map len bytes of anonymous memory with additional mmap() flags.
+ */
+bool LargeMemory::map(size_t len, int flags, enum page_type pages)
+{
+#ifdef HAVE_MMAP
+	/* Mappings of normal pages are aligned to 2 MiB by mapping a bit
+	 * more and unmapping the excess. */
+	const size_t slack = (flags == 0 && len >= SIZE_2M) ? SIZE_2M : 0;
+
+	void * p = mmap(NULL, len + slack, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+	if (p == MAP_FAILED) {
+		return false;
+	}
+
+	char * start = (char *) p;
+	if (slack > 0) {
+		start = (char *) (((uintptr_t) p + SIZE_2M - 1)
+				& ~(uintptr_t) (SIZE_2M - 1));
+		if (start > (char *) p) {
+			munmap(p, start - (char *) p);
+		}
+		if (start + len < (char *) p + len + slack) {
+			munmap(start + len, (char *) p + len + slack
+					- (start + len));
+		}
+	}
+
+	mem = start;
+	mapped_size = len;
+	this->pages = pages;
+	return true;
+#else
+	(void) len;
+	(void) flags;
+	(void) pages;
+	return false;
+#endif
+}
+
+/*
+ * Map the POSIX shared memory object `name' (e.g. "/hoichess"). If it does
+ * not exist yet and readonly is false, it is created with size bytes,
+ * which are zero. Otherwise the size of the existing object is used.
+ * The object is not removed when it is unmapped, so that a table filled
+ * by one process can later be used by others.
+ *
+ * Returns NULL and sets *error if the object cannot be mapped.
+ */
+LargeMemory * LargeMemory::open_shared(const char * name, size_t size,
+		bool readonly, std::string * error)
+{
+#if defined(HAVE_MMAP) && defined(_POSIX_SHARED_MEMORY_OBJECTS)
+	bool created = false;
+	int fd = -1;
+
+	if (!readonly) {
+		fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+		if (fd >= 0) {
+			created = true;
+			if (ftruncate(fd, size) < 0) {
+				*error = strprintf("Cannot resize shared"
+						" memory %s: %s\n", name,
+						strerror(errno));
+				close(fd);
+				shm_unlink(name);
+				return NULL;
+			}
+		} else if (errno != EEXIST) {
+			*error = strprintf("Cannot create shared memory %s:"
+					" %s\n", name, strerror(errno));
+			return NULL;
+		}
+	}
+
+	if (fd < 0) {
+		fd = shm_open(name, readonly ? O_RDONLY : O_RDWR, 0);
+		if (fd < 0) {
+			*error = strprintf("Cannot open shared memory %s: %s\n",
+					name, strerror(errno));
+			return NULL;
+		}
+
+		/* Another process may just have created the object,
+		 * but not yet set its size. */
+		struct stat st;
+		for (unsigned int i = 0; ; i++) {
+			if (fstat(fd, &st) < 0) {
+				*error = strprintf("Cannot stat shared memory"
+						" %s: %s\n", name,
+						strerror(errno));
+				close(fd);
+				return NULL;
+			}
+			if (st.st_size > 0) {
+				break;
+			}
+			if (i == 100) {
+				*error = strprintf("Shared memory %s is"
+						" empty\n", name);
+				close(fd);
+				return NULL;
+			}
+			usleep(10000);
+		}
+		size = st.st_size;
+	}
+
+	void * p = mmap(NULL, size, readonly ? PROT_READ
+			: PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		*error = strprintf("Cannot map shared memory %s: %s\n",
+				name, strerror(errno));
+		if (created) {
+			shm_unlink(name);
+		}
+		return NULL;
+	}
+
+	LargeMemory * m = new LargeMemory();
+	m->mem = (char *) p;
+	m->size = size;
+	m->mapped_size = size;
+	m->shared = true;
+	m->created = created;
+	m->readonly = readonly;
+# ifdef MADV_HUGEPAGE
+	if (size >= SIZE_2M && madvise(p, size, MADV_HUGEPAGE) == 0) {
+		m->pages = PAGES_TRANSPARENT;
+	}
+# endif
+	return m;
+#else
+	(void) name;
+	(void) size;
+	(void) readonly;
+	*error = "Shared memory is not supported on this platform.\n";
+	return NULL;
+#endif
+}
+
+/*
+ * Remove the POSIX shared memory object `name'. Processes that have it
+ * mapped can continue to use it.
+ */
+bool LargeMemory::remove_shared(const char * name, std::string * error)
+{
+#if defined(HAVE_MMAP) && defined(_POSIX_SHARED_MEMORY_OBJECTS)
+	if (shm_unlink(name) < 0) {
+		*error = strprintf("Cannot remove shared memory %s: %s\n",
+				name, strerror(errno));
+		return false;
+	}
+	return true;
+#else
+	(void) name;
+	*error = "Shared memory is not supported on this platform.\n";
+	return false;
+#endif
+}
+
+
+struct clear_job {
+	char * start;
+	size_t len;
+};
+
+static void * clear_thread(void * arg)
+{
+	struct clear_job * job = (struct clear_job *) arg;
+	memset(job->start, 0, job->len);
+	return NULL;
+}
+
+/*
+ * Zero the memory, except for the first offset bytes. Large tables are
+ * split into chunks of whole huge pages, which are cleared by one thread
+ * per CPU.
+ */
+void LargeMemory::clear(size_t offset)
+{
+	ASSERT(!readonly);
+	ASSERT(offset <= size);
+	char * start = (char *) get() + offset;
+	const size_t len = size - offset;
+
+	unsigned int nr_threads = 1;
+#if defined(HAVE_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+	if (len >= PARALLEL_CLEAR_MIN) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		nr_threads = (n > 1) ? MIN((unsigned long) n, MAXTHREADS) : 1;
+	}
+#endif
+
+	if (nr_threads == 1) {
+		memset(start, 0, len);
+		return;
+	}
+
+	const size_t chunk = (len / nr_threads + SIZE_2M - 1)
+		& ~(SIZE_2M - 1);
+	std::vector<struct clear_job> jobs;
+	for (size_t off = 0; off < len; off += chunk) {
+		struct clear_job job = { start + off,
+			MIN(chunk, len - off) };
+		jobs.push_back(job);
+	}
+
+	std::vector<Thread *> threads;
+	for (unsigned int i = 0; i < jobs.size(); i++) {
+		Thread * thread = new Thread(clear_thread);
+		thread->start(&jobs[i]);
+		threads.push_back(thread);
+	}
+	for (unsigned int i = 0; i < threads.size(); i++) {
+		threads[i]->wait();
+		delete threads[i];
+	}
+}
+
+/*
+ * Number of bytes of the mapping that are backed by transparent huge
+ * pages, as reported by the kernel.
+ */
+size_t LargeMemory::get_huge_bytes() const
+{
+#if defined(HAVE_MMAP) && defined(__linux__)
+	FILE * fp = fopen("/proc/self/smaps", "r");
+	if (!fp) {
+		return 0;
+	}
+
+	char line[256];
+	bool inside = false;
+	size_t bytes = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		unsigned long start, end, kb;
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+			inside = (start >= (uintptr_t) mem
+				  && end <= (uintptr_t) mem + mapped_size);
+		} else if (inside && (sscanf(line, "AnonHugePages: %lu kB",
+						&kb) == 1
+					|| sscanf(line, "ShmemPmdMapped: %lu kB",
+						&kb) == 1)) {
+			bytes += (size_t) kb << 10;
+		}
+	}
+
+	fclose(fp);
+	return bytes;
+#else
+	return 0;
+#endif
+}
+
+void LargeMemory::print_info(const char * name, FILE * fp) const
+{
+	switch (pages) {
+	case PAGES_HUGETLB_1G:
+		fprintf(fp, "%s pages: 1 GiB huge pages\n", name);
+		break;
+	case PAGES_HUGETLB_2M:
+		fprintf(fp, "%s pages: 2 MiB huge pages\n", name);
+		break;
+	case PAGES_TRANSPARENT:
+		fprintf(fp, "%s pages: transparent huge pages"
+				" (%.1f of %.1f MiB)\n", name,
+				(float) get_huge_bytes() / (1<<20),
+				(float) mapped_size / (1<<20));
+		break;
+	default:
+		fprintf(fp, "%s pages: normal pages\n", name);
+		break;
+	}
+}
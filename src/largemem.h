@@ -0,0 +1,129 @@
+/* $Id$
+ *
+ * HoiChess/largemem.h
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef LARGEMEM_H
+#define LARGEMEM_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include <string>
+
+
+/*****************************************************************************
+ *
+ * Class LargeMemory
+ *
+ * Zero-initialized memory for the hash tables. Where possible, it is
+ * backed by huge pages to save TLB misses on random table accesses:
+ * explicit 1 GiB or 2 MiB pages (MAP_HUGETLB) if the system has reserved
+ * some, otherwise transparent huge pages (madvise). The memory is cleared
+ * by several threads in parallel, which also spreads the pages over the
+ * NUMA nodes of the threads that first touch them.
+ *
+ * open_shared() maps a named POSIX shared memory object instead, so that
+ * several processes can use the same memory.
+ *
+ *****************************************************************************/
+
+class LargeMemory
+{
+      public:
+	enum page_type {
+		PAGES_NORMAL,
+		PAGES_TRANSPARENT,
+		PAGES_HUGETLB_2M,
+		PAGES_HUGETLB_1G
+	};
+
+      private:
+	char * mem;
+	size_t size;
+	size_t mapped_size;
+	enum page_type pages;
+	bool shared;
+	bool created;
+	bool readonly;
+
+      public:
+	LargeMemory(size_t size);
+	~LargeMemory();
+      private:
+	LargeMemory();
+
+      public:
+	static LargeMemory * open_shared(const char * name, size_t size,
+			bool readonly, std::string * error);
+	static bool remove_shared(const char * name, std::string * error);
+
+      public:
+	void * get() const;
+	size_t get_size() const;
+	bool is_shared() const;
+	bool is_created() const;
+	bool is_readonly() const;
+	void clear(size_t offset = 0);
+	void print_info(const char * name, FILE * fp = stdout) const;
+
+      private:
+	bool map(size_t size, int flags, enum page_type pages);
+	size_t get_huge_bytes() const;
+};
+
+/*
+ * Returns the start of the memory, aligned to at least 64 bytes.
+ */
+inline void * LargeMemory::get() const
+{
+	if (mapped_size > 0) {
+		return mem;
+	}
+	return (void *) (((uintptr_t) mem + 63) & ~(uintptr_t) 63);
+}
+
+inline size_t LargeMemory::get_size() const
+{
+	return size;
+}
+
+inline bool LargeMemory::is_shared() const
+{
+	return shared;
+}
+
+/*
+ * True if open_shared() has created the shared memory object, i.e. this
+ * process is the first one to use it.
+ */
+inline bool LargeMemory::is_created() const
+{
+	return created;
+}
+
+inline bool LargeMemory::is_readonly() const
+{
+	return readonly;
+}
+
+#endif // LARGEMEM_H
@@ -93,10 +93,13 @@ static void usage(const char * argv0)
 	printf("       --book FILE      Specify file name of opening book (default: %s)\n", DEFAULT_BOOK);
 	printf("       --nobook         Disable opening book\n");
 	printf("       --hashsize SIZE  Set size of main hash table (default: %s)\n", DEFAULT_HASHSIZE);
+	printf("       --hashshm NAME   Share main hash table in shared memory object NAME\n");
+	printf("       --hashshm-readonly NAME  Use shared hash table NAME without modifying it\n");
 	printf("       --pawnhashsize SIZE  Set size of pawn hash table (default: %s)\n", DEFAULT_PAWNHASHSIZE);
 #ifdef USE_EVALCACHE
 	printf("       --evalcache SIZE	Set size of evaluation cache (default: %s)\n", DEFAULT_EVALCACHESIZE);
 #endif
+	printf("       --threads N      Use N search threads (default: 1)\n");
 	printf("       --rcfile FILE    Read initial commands from FILE\n");
 
 	printf(
@@ -118,6 +121,9 @@ int main(int argc, char ** argv)
 	const char * opt_color = "auto";
 	const char * opt_evalcache = DEFAULT_EVALCACHESIZE;
 	const char * opt_pawnhashsize = DEFAULT_PAWNHASHSIZE;
+	const char * opt_threads = NULL;
+	const char * opt_hashshm = NULL;
+	bool opt_hashshm_readonly = false;
 
 	/* Most Unix platforms have color terminals. But on Win32 systems,
 	 * ANSI color is normally not available. */
@@ -149,6 +155,9 @@ int main(int argc, char ** argv)
 		{ "color", 1, 0, 133 },
 		{ "evalcache", 1, 0, 134 },
 		{ "pawnhashsize", 1, 0, 135 },
+		{ "threads", 1, 0, 136 },
+		{ "hashshm", 1, 0, 137 },
+		{ "hashshm-readonly", 1, 0, 138 },
 		
 		{ 0, 0, 0, 0 }
 	};
@@ -215,6 +224,17 @@ int main(int argc, char ** argv)
 		case 135: /* --pawnhashsize */
 			opt_pawnhashsize = optarg;
 			break;
+		case 136: /* --threads */
+			opt_threads = optarg;
+			break;
+		case 137: /* --hashshm */
+			opt_hashshm = optarg;
+			opt_hashshm_readonly = false;
+			break;
+		case 138: /* --hashshm-readonly */
+			opt_hashshm = optarg;
+			opt_hashshm_readonly = true;
+			break;
 			
 		case '?':
 			usage(argv[0]);
@@ -314,6 +334,9 @@ int main(int argc, char ** argv)
 	shell->set_book(opt_bookfile);
 	
 	/* main hash size */
+	if (opt_hashshm) {
+		shell->set_hashshm(opt_hashshm, opt_hashshm_readonly);
+	}
 	if (opt_hashsize) {
 		long size = 0;
 		if (!parse_size(opt_hashsize, &size) || size < 0) {
@@ -352,6 +375,18 @@ int main(int argc, char ** argv)
 	}
 #endif
 
+	/* number of search threads */
+	if (opt_threads) {
+		unsigned int n;
+		if (sscanf(opt_threads, "%u", &n) != 1 || n < 1) {
+			printf("Error: Illegal number of threads: %s\n",
+					opt_threads);
+			exit(EXIT_FAILURE);
+		}
+
+		shell->set_threads(n);
+	}
+
 	/* read script file if given on command line */
 	if (opt_rcfile) {
 		FILE * fp = fopen(opt_rcfile, "r");
@@ -0,0 +1,362 @@
+/* $Id$
+ *
+ * HoiChess/match.cc
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "basic.h"
+#include "game.h"
+#include "match.h"
+#include "pgn.h"
+#include "util.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * The sizes of the tables are given in entries. They are divided among
+ * the players of all jobs.
+ */
+Match::Match(Shell * shell, unsigned int nr_jobs, unsigned long hashsize,
+		unsigned long pawnhashsize, unsigned long evalcachesize,
+		unsigned int depthlimit, const bool * stop)
+{
+	ASSERT(nr_jobs > 0);
+	this->stop = stop;
+	name[0] = strprintf("%s A", PROGNAME);
+	name[1] = strprintf("%s B", PROGNAME);
+
+	const unsigned int n = 2 * nr_jobs;
+	for (unsigned int i=0; i<nr_jobs; i++) {
+		struct job job;
+		for (unsigned int j=0; j<2; j++) {
+			struct player * p = &job.players[j];
+			p->search = new Search(shell);
+			p->hashtable = (hashsize / n > 0)
+				? new HashTable(hashsize / n) : NULL;
+			p->pawnhashtable = (pawnhashsize / n > 0)
+				? new PawnHashTable(pawnhashsize / n) : NULL;
+			p->evalcache = NULL;
+#ifdef USE_EVALCACHE
+			if (evalcachesize / n > 0) {
+				p->evalcache = new EvaluationCache(
+						evalcachesize / n);
+			}
+#else
+			(void) evalcachesize;
+#endif
+			p->search->set_hashtable(p->hashtable);
+			p->search->set_pawnhashtable(p->pawnhashtable);
+			p->search->set_evalcache(p->evalcache);
+			p->search->set_depthlimit(depthlimit);
+		}
+		jobs.push_back(job);
+	}
+
+	pool = new ThreadPool(nr_jobs);
+	pgnfile = NULL;
+}
+
+Match::~Match()
+{
+	delete pool;
+	for (unsigned int i=0; i<jobs.size(); i++) {
+		for (unsigned int j=0; j<2; j++) {
+			struct player * p = &jobs[i].players[j];
+			delete p->search;
+			delete p->hashtable;
+			delete p->pawnhashtable;
+			delete p->evalcache;
+		}
+	}
+}
+
+/*
+ * Set a search parameter of player B.
+ */
+void Match::set_param(const std::string & name, const std::string & value)
+{
+	for (unsigned int i=0; i<jobs.size(); i++) {
+		jobs[i].players[1].search->set_param(name, value);
+	}
+	this->name[1] += strprintf(" %s=%s", name.c_str(), value.c_str());
+}
+
+/*
+ * Read the opening positions from a PGN file (the positions at the end of
+ * its games) or from an EPD file. Returns false if the file cannot be
+ * read or contains no usable position.
+ */
+bool Match::read_openings(const char * filename)
+{
+	const size_t len = strlen(filename);
+	if (len > 4 && strcasecmp(filename + len - 4, ".pgn") == 0) {
+		PGNReader reader;
+		if (!reader.open(filename)) {
+			return false;
+		}
+		PGNReader::status st;
+		while ((st = reader.next()) != PGNReader::NO_MORE_GAMES) {
+			if (st != PGNReader::GAME_OK) {
+				continue;
+			}
+			Board board = reader.get_opening();
+			const std::vector<Move> & moves = reader.get_moves();
+			for (unsigned int i=0; i<moves.size(); i++) {
+				board.make_move(moves[i]);
+			}
+			openings.push_back(board);
+		}
+	} else {
+		FILE * fp;
+		if ((fp = fopen(filename, "r")) == NULL) {
+			printf("Cannot open %s: %s\n", filename,
+					strerror(errno));
+			return false;
+		}
+
+		char buf[1024];
+		while (fgets(buf, sizeof(buf), fp) != NULL) {
+			if (strspn(buf, " \t\r\n") == strlen(buf)) {
+				continue;
+			}
+			EPD epd(buf);
+			Board board;
+			if (!board.parse_fen(epd.get_fen())) {
+				printf("Skipping illegal position: %s", buf);
+				continue;
+			}
+			openings.push_back(board);
+		}
+
+		fclose(fp);
+	}
+
+	if (openings.empty()) {
+		printf("No opening positions in %s\n", filename);
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Create n openings by following random book moves from the initial
+ * position, up to the given number of plies. Returns false if there is
+ * no book or all openings are the same position: both players search
+ * deterministically with the same parameters, so all games would be the
+ * same and the result would mean nothing.
+ */
+bool Match::book_openings(const Book * book, unsigned int n,
+		unsigned int plies)
+{
+	if (book == NULL) {
+		printf("No opening book, an openings file is required\n");
+		return false;
+	}
+
+	bool distinct = false;
+	for (unsigned int i=0; i<n; i++) {
+		Board board(opening_fen());
+		for (unsigned int ply=0; ply<plies; ply++) {
+			BookEntry entry;
+			if (!book->lookup(board, &entry)) {
+				break;
+			}
+			board.make_move(entry.choose());
+		}
+		if (!openings.empty() && board.get_hashkey()
+				!= openings[0].get_hashkey()) {
+			distinct = true;
+		}
+		openings.push_back(board);
+	}
+
+	if (!distinct) {
+		printf("All openings from the book are the same position,"
+				" an openings file is required\n");
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Play nr_games games, each with the given clock for both sides, and
+ * append them to the PGN file. Returns false if the PGN file cannot be
+ * opened.
+ */
+bool Match::play(unsigned int nr_games, const Clock & clock,
+		const char * pgnfilename)
+{
+	ASSERT(!openings.empty());
+
+	if ((pgnfile = fopen(pgnfilename, "a")) == NULL) {
+		printf("Cannot open %s: %s\n", pgnfilename, strerror(errno));
+		return false;
+	}
+
+	this->clock = clock;
+	wins = 0;
+	losses = 0;
+	draws = 0;
+
+	for (unsigned int i=0; i<nr_games; i++) {
+		struct game g;
+		g.match = this;
+		g.round = i + 1;
+		g.opening = openings[(i / 2) % openings.size()];
+		g.a_is_white = (i % 2 == 0);
+		games.push_back(g);
+	}
+
+	printf("Playing %u games with %u jobs: %s vs. %s\n", nr_games,
+			(unsigned int) jobs.size(),
+			name[0].c_str(), name[1].c_str());
+
+	Clock wallclock;
+	wallclock.start();
+
+	for (unsigned int i=0; i<games.size(); i++) {
+		pool->submit(i % jobs.size(), game_task, &games[i]);
+	}
+	pool->wait();
+
+	const unsigned int wall = wallclock.stop();
+
+	fclose(pgnfile);
+	pgnfile = NULL;
+
+	printf("--------------------------------------------------\n");
+	print_summary();
+	printf("Time: %.2f s\n", (float) wall / 100);
+	log("match finished: +%u -%u =%u\n", wins, losses, draws);
+	return true;
+}
+
+void Match::game_task(void * arg, unsigned int worker)
+{
+	const struct game * g = (const struct game *) arg;
+	g->match->play_game(*g, worker);
+}
+
+void Match::play_game(const struct game & g, unsigned int worker)
+{
+	if (*stop) {
+		return;
+	}
+
+	/* players[WHITE] and players[BLACK] */
+	struct player * players[2];
+	players[WHITE] = &jobs[worker].players[g.a_is_white ? 0 : 1];
+	players[BLACK] = &jobs[worker].players[g.a_is_white ? 1 : 0];
+	for (unsigned int i=0; i<2; i++) {
+		if (players[i]->hashtable) {
+			players[i]->hashtable->clear();
+		}
+		if (players[i]->pawnhashtable) {
+			players[i]->pawnhashtable->clear();
+		}
+		if (players[i]->evalcache) {
+			players[i]->evalcache->clear();
+		}
+	}
+
+	Game game(g.opening, clock, clock);
+	game.start();
+	while (!game.is_over()) {
+		if (*stop) {
+			return;
+		}
+
+		const Color side = (Color) game.get_side();
+		Search * search = players[side]->search;
+		search->start(game, Search::MOVE, side);
+		Move mov = search->get_best();
+		if (!mov.is_valid(game.get_board())
+				|| !mov.is_legal(game.get_board())) {
+			BUG("search returned illegal move: %s",
+					mov.str().c_str());
+		}
+		game.make_move(mov, GameEntry::MoveAttributes(true, false));
+	}
+
+	const std::string result = game.get_result_str();
+	const char * white = name[g.a_is_white ? 0 : 1].c_str();
+	const char * black = name[g.a_is_white ? 1 : 0].c_str();
+
+	mutex.lock();
+	if (result == "1-0" || result == "0-1") {
+		if ((result == "1-0") == g.a_is_white) {
+			wins++;
+		} else {
+			losses++;
+		}
+	} else if (result == "1/2-1/2") {
+		draws++;
+	}
+	game.write_pgn(pgnfile, white, black, g.round);
+	fprintf(pgnfile, "\n");
+	fflush(pgnfile);
+
+	printf("Game %u: %s - %s: %s {%s}\n", g.round, white, black,
+			result.c_str(), game.get_result_comment().c_str());
+	print_summary();
+	fflush(stdout);
+	mutex.unlock();
+}
+
+/*
+ * Logistic Elo difference for the expected score p.
+ */
+static double elo(double p)
+{
+	return -400.0 * log10(1.0 / p - 1.0);
+}
+
+/*
+ * Print score and Elo difference of A, with a 95% confidence interval
+ * from the standard deviation of the game results.
+ */
+void Match::print_summary() const
+{
+	const unsigned int n = wins + losses + draws;
+	if (n == 0) {
+		return;
+	}
+
+	const double p = (wins + 0.5 * draws) / n;
+	printf("Score of %s: +%u -%u =%u (%.1f%%)", name[0].c_str(),
+			wins, losses, draws, 100 * p);
+
+	if (p > 0 && p < 1) {
+		const double var = (wins * (1 - p) * (1 - p)
+				+ draws * (0.5 - p) * (0.5 - p)
+				+ losses * p * p) / n;
+		const double dev = 1.96 * sqrt(var / n);
+		const double lo = MAX(p - dev, 0.001);
+		const double hi = MIN(p + dev, 0.999);
+		printf(", Elo %+.0f +/- %.0f", elo(p) + 0.0,
+				(elo(hi) - elo(lo)) / 2);
+	}
+	printf("\n");
+}
@@ -0,0 +1,116 @@
+/* $Id$
+ *
+ * HoiChess/match.h
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef MATCH_H
+#define MATCH_H
+
+#include "common.h"
+#include "board.h"
+#include "book.h"
+#include "clock.h"
+#include "evalcache.h"
+#include "hash.h"
+#include "pawnhash.h"
+#include "search.h"
+#include "thread.h"
+
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+/* forward declaration */
+class Shell;
+
+
+/*****************************************************************************
+ *
+ * Class Match
+ *
+ * Self-play match between two players, A and B, which are searches with
+ * the same settings, except for the search parameters given for B. The
+ * games are played concurrently, one per job, and each job has its own
+ * pair of players with their own tables. Every opening is played twice,
+ * with A as white and with A as black. Finished games are appended to a
+ * PGN file.
+ *
+ *****************************************************************************/
+
+class Match
+{
+      private:
+	struct player {
+		Search * search;
+		HashTable * hashtable;
+		PawnHashTable * pawnhashtable;
+		EvaluationCache * evalcache;
+	};
+
+	struct job {
+		struct player players[2];	/* A and B */
+	};
+
+	struct game {
+		Match * match;
+		unsigned int round;
+		Board opening;
+		bool a_is_white;
+	};
+
+      private:
+	const bool * stop;
+	Clock clock;
+	std::vector<struct job> jobs;
+	std::vector<Board> openings;
+	std::vector<struct game> games;
+	ThreadPool * pool;
+	std::string name[2];
+
+	/* The following are protected by mutex. */
+	Mutex mutex;
+	FILE * pgnfile;
+	unsigned int wins;	/* of A */
+	unsigned int losses;
+	unsigned int draws;
+
+      public:
+	Match(Shell * shell, unsigned int nr_jobs, unsigned long hashsize,
+			unsigned long pawnhashsize,
+			unsigned long evalcachesize,
+			unsigned int depthlimit, const bool * stop);
+	~Match();
+
+      public:
+	void set_param(const std::string & name, const std::string & value);
+	bool read_openings(const char * filename);
+	bool book_openings(const Book * book, unsigned int n,
+			unsigned int plies);
+	bool play(unsigned int nr_games, const Clock & clock,
+			const char * pgnfilename);
+
+      private:
+	static void game_task(void * arg, unsigned int worker);
+	void play_game(const struct game & g, unsigned int worker);
+	void print_summary() const;
+};
+
+#endif // MATCH_H
@@ -38,8 +38,11 @@ PawnHashTable::PawnHashTable(unsigned long size)
 {
 	ASSERT(size > 0);
 
+	/* The table is zeroed memory, and a slot is empty if its hashkey
+	 * is 0. Positions with pawn hashkey 0 are never stored. */
 	table_size = size;
-	table = new PawnHashEntry[table_size];
+	table_mem = new LargeMemory(table_size * sizeof(PawnHashEntry));
+	table = (PawnHashEntry *) table_mem->get();
 	entries = 0;
 
 	reset_statistics();
@@ -47,13 +50,12 @@ PawnHashTable::PawnHashTable(unsigned long size)
 
 PawnHashTable::~PawnHashTable()
 {
-	delete[] table;
+	delete table_mem;
 }
 
 void PawnHashTable::clear()
 {
-	delete[] table;
-	table = new PawnHashEntry[table_size];
+	table_mem->clear();
 	entries = 0;
 
 	reset_statistics();
@@ -61,10 +63,14 @@ void PawnHashTable::clear()
 
 bool PawnHashTable::put(const PawnHashEntry & entry)
 {
+	if (entry.hashkey == 0) {
+		return false;
+	}
+
 	const unsigned long key = entry.hashkey % table_size;
 	const PawnHashEntry & e = table[key];
 
-	if (e.phase == -1) {
+	if (e.hashkey == 0) {
 		entries++;
 	} else {
 		/* Always replace. */
@@ -84,7 +90,7 @@ bool PawnHashTable::probe(Hashkey hashkey, PawnHashEntry * entry)
 	const unsigned long key = hashkey % table_size;
 	const PawnHashEntry & e = table[key];
 	
-	if (e.phase == -1 || e.hashkey != hashkey) {
+	if (e.hashkey == 0 || e.hashkey != hashkey) {
 		entry->phase = -1;
 		return false;
 	}
@@ -102,6 +108,7 @@ void PawnHashTable::print_info(FILE * fp) const
 	fprintf(fp, "Pawn hash table usage: %lu entries (%lu%%)\n",
 			entries,
 			entries*100/table_size);
+	table_mem->print_info("Pawn hash table", fp);
 }
 
 void PawnHashTable::print_statistics(FILE * fp) const
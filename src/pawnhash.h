@@ -26,6 +26,7 @@
 #include "common.h"
 #include "board.h"
 #include "hash.h"
+#include "largemem.h"
 #include "move.h"
 #include "util.h"
 
@@ -135,6 +136,7 @@ class PawnHashTable
 {
       private:
 	unsigned long table_size;
+	LargeMemory * table_mem;
 	PawnHashEntry * table;
 
 	unsigned long entries;
@@ -155,6 +157,7 @@ class PawnHashTable
 	bool put(const PawnHashEntry & entry);
 	bool probe(Hashkey hashkey, PawnHashEntry * entry);	
 	inline void incr_hits2();
+	inline unsigned long get_size() const;
 
 	void print_info(FILE * fp = stdout) const;
 	void print_statistics(FILE * fp = stdout) const;
@@ -166,4 +169,9 @@ inline void PawnHashTable::incr_hits2()
 	STAT_INC(stat_hits2);
 }
 
+inline unsigned long PawnHashTable::get_size() const
+{
+	return table_size;
+}
+
 #endif // HASHPAWN_H
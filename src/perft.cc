@@ -0,0 +1,223 @@
+/* $Id$
+ *
+ * HoiChess/perft.cc
+ *
+ * Copyright (C) 2005 Holger Ruckdeschel <holger@hoicher.de>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "perft.h"
+
+#include "clock.h"
+#include "movelist.h"
+
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * Create a perft object. hashsize is the size of the perft hash table in
+ * bytes (0 disables it), bulk enables bulk counting of the legal moves at
+ * depth 1, threads is the number of threads the root moves are split
+ * across.
+ */
+Perft::Perft(unsigned long hashsize, bool bulk, unsigned int threads)
+{
+	this->bulk = bulk;
+	nr_threads = threads > 0 ? threads : 1;
+
+	/* Use a power of two number of entries. */
+	hash_size = 0;
+	hashtable = NULL;
+	if (hashsize >= sizeof(struct hashentry)) {
+		hash_size = 1;
+		while (hash_size * 2 * sizeof(struct hashentry) <= hashsize) {
+			hash_size *= 2;
+		}
+		hashtable = new struct hashentry[hash_size];
+		memset(hashtable, 0, hash_size * sizeof(struct hashentry));
+	}
+
+	rootboard = NULL;
+	depth = 0;
+	next_rootmove = 0;
+}
+
+Perft::~Perft()
+{
+	delete[] hashtable;
+}
+
+uint64_t Perft::perft(const Board & board, unsigned int depth)
+{
+	if (depth == 0) {
+		return 1;
+	}
+
+	uint64_t nodes = 0;
+	if (depth >= 2 && hash_probe(board, depth, &nodes)) {
+		return nodes;
+	}
+
+	Movelist movelist;
+	board.generate_moves(&movelist);
+
+	for (unsigned int i = 0; i < movelist.size(); i++) {
+		Board newboard = board;
+		newboard.make_move(movelist[i]);
+		if (!newboard.is_legal()) {
+			continue;
+		}
+
+		if (bulk && depth == 1) {
+			nodes++;
+		} else {
+			nodes += perft(newboard, depth - 1);
+		}
+	}
+
+	if (depth >= 2) {
+		hash_put(board, depth, nodes);
+	}
+
+	return nodes;
+}
+
+/*
+ * Run perft on the given position and print the number of leaf nodes and
+ * the speed. With divide, print the number of leaf nodes below each
+ * root move, too.
+ */
+void Perft::run(const Board & board, unsigned int depth, bool divide)
+{
+	rootboard = &board;
+	this->depth = depth;
+
+	rootmoves.clear();
+	if (depth > 0) {
+		board.generate_moves(&rootmoves);
+		rootmoves.filter_illegal(board);
+	}
+	rootnodes.assign(rootmoves.size(), 0);
+	next_rootmove = 0;
+
+	Clock clock;
+	clock.start();
+
+	if (nr_threads == 1 || rootmoves.size() <= 1) {
+		search_rootmoves();
+	} else {
+		std::vector<Thread *> threads;
+		for (unsigned int i = 0; i < nr_threads; i++) {
+			Thread * thread = new Thread(thread_main);
+			thread->start(this);
+			threads.push_back(thread);
+		}
+		for (unsigned int i = 0; i < threads.size(); i++) {
+			threads[i]->wait();
+			delete threads[i];
+		}
+	}
+
+	clock.stop();
+
+	uint64_t nodes = (depth == 0) ? 1 : 0;
+	for (unsigned int i = 0; i < rootmoves.size(); i++) {
+		if (divide) {
+			printf("%s: %llu\n", rootmoves[i].str().c_str(),
+					(unsigned long long) rootnodes[i]);
+		}
+		nodes += rootnodes[i];
+	}
+	if (divide) {
+		printf("Moves: %u\n", rootmoves.size());
+	}
+
+	float secs = (float) clock.get_elapsed_time() / 100;
+	printf("Perft(%u): %llu nodes, time %.2f s", depth,
+			(unsigned long long) nodes, secs);
+	if (secs > 0) {
+		printf(", %.1f knodes/s", nodes / secs / 1000);
+	}
+	printf("\n");
+
+	log("perft: depth=%u, nodes=%llu, time=%.2f, threads=%u, "
+			"bulk=%d, hash=%lu\n", depth, (unsigned long long) nodes,
+			secs, nr_threads, bulk, hash_size);
+
+	rootboard = NULL;
+}
+
+/*
+ * Take root moves from the shared list and count their subtrees, until
+ * all root moves are done.
+ */
+void Perft::search_rootmoves()
+{
+	for (;;) {
+		rootmoves_mutex.lock();
+		const unsigned int i = next_rootmove++;
+		rootmoves_mutex.unlock();
+
+		if (i >= rootmoves.size()) {
+			break;
+		}
+
+		Board newboard = *rootboard;
+		newboard.make_move(rootmoves[i]);
+		rootnodes[i] = perft(newboard, depth - 1);
+	}
+}
+
+void * Perft::thread_main(void * arg)
+{
+	Perft * perft = (Perft *) arg;
+	perft->search_rootmoves();
+	return NULL;
+}
+
+bool Perft::hash_probe(const Board & board, unsigned int depth,
+		uint64_t * nodes) const
+{
+	if (!hashtable) {
+		return false;
+	}
+
+	const Hashkey hashkey = board.get_hashkey();
+	const struct hashentry e = hashtable[hashkey & (hash_size - 1)];
+	if ((e.lock ^ e.data) != hashkey || (e.data & 0xff) != depth) {
+		return false;
+	}
+
+	*nodes = e.data >> 8;
+	return true;
+}
+
+void Perft::hash_put(const Board & board, unsigned int depth, uint64_t nodes)
+{
+	if (!hashtable) {
+		return;
+	}
+
+	const Hashkey hashkey = board.get_hashkey();
+	struct hashentry * e = &hashtable[hashkey & (hash_size - 1)];
+	const uint64_t data = (nodes << 8) | (depth & 0xff);
+	e->lock = hashkey ^ data;
+	e->data = data;
+}
@@ -0,0 +1,87 @@
+/* $Id$
+ *
+ * HoiChess/perft.h
+ *
+ * Copyright (C) 2005 Holger Ruckdeschel <holger@hoicher.de>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef PERFT_H
+#define PERFT_H
+
+#include "common.h"
+#include "board.h"
+#include "hash.h"
+#include "thread.h"
+
+#include <vector>
+
+/*****************************************************************************
+ *
+ * Class Perft
+ *
+ * Count the leaf nodes of the legal move tree of a position up to a given
+ * depth. This is used to verify the move generator and to measure move
+ * generation plus make_move() speed.
+ *
+ *****************************************************************************/
+
+class Perft
+{
+      private:
+	/* Entries of the perft hash table. As in the main hash table,
+	 * the stored key is XOR'ed with the data, so that the table can
+	 * be shared by all threads without locking. The data word holds
+	 * the node count in the upper 56 bits and the depth in the lower
+	 * 8 bits. */
+	struct hashentry {
+		uint64_t lock;
+		uint64_t data;
+	};
+
+      private:
+	bool bulk;
+	unsigned int nr_threads;
+
+	unsigned long hash_size;
+	struct hashentry * hashtable;
+
+	/* Root moves, shared by all threads. */
+	const Board * rootboard;
+	unsigned int depth;
+	Movelist rootmoves;
+	std::vector<uint64_t> rootnodes;
+	unsigned int next_rootmove;
+	Mutex rootmoves_mutex;
+
+      public:
+	Perft(unsigned long hashsize, bool bulk, unsigned int threads);
+	~Perft();
+
+      public:
+	uint64_t perft(const Board & board, unsigned int depth);
+	void run(const Board & board, unsigned int depth, bool divide);
+
+      private:
+	void search_rootmoves();
+	static void * thread_main(void * arg);
+	bool hash_probe(const Board & board, unsigned int depth,
+			uint64_t * nodes) const;
+	void hash_put(const Board & board, unsigned int depth, uint64_t nodes);
+};
+
+#endif // PERFT_H
@@ -28,8 +28,14 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef HAVE_MMAP
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
 #include <sstream>
 
 
@@ -259,6 +265,438 @@ std::list<PGN> PGN::parse_all(const char * filename)
 }
 
 
+
+/*****************************************************************************
+ *
+ * Member functions of class PGNReader.
+ *
+ *****************************************************************************/
+
+PGNReader::PGNReader()
+{
+	fp = NULL;
+	mapping = NULL;
+	mapping_size = 0;
+	buf = NULL;
+	bufsize = 0;
+
+	data = NULL;
+	len = pos = 0;
+	at_eof = true;
+	data_at_line_start = true;
+
+	if (!startpos.parse_fen(opening_fen())) {
+		BUG("Failed to set up standard opening position");
+	}
+	moves.reserve(MAXPLY);
+}
+
+PGNReader::~PGNReader()
+{
+	close();
+}
+
+bool PGNReader::open(const char * filename)
+{
+	close();
+
+	fp = fopen(filename, "rb");
+	if (!fp) {
+		fprintf(stderr, "Cannot open %s for reading: %s\n",
+				filename, strerror(errno));
+		return false;
+	}
+
+#ifdef HAVE_MMAP
+	struct stat st;
+	if (fstat(fileno(fp), &st) == 0 && st.st_size > 0) {
+		void * p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED,
+				fileno(fp), 0);
+		if (p != MAP_FAILED) {
+			madvise(p, st.st_size, MADV_SEQUENTIAL);
+			mapping = (const char *) p;
+			mapping_size = st.st_size;
+			fclose(fp);
+			fp = NULL;
+
+			data = mapping;
+			len = mapping_size;
+			pos = 0;
+			at_eof = true;
+			data_at_line_start = true;
+			return true;
+		}
+	}
+#endif
+
+	bufsize = BUFSIZE;
+	buf = (char *) malloc(bufsize);
+	if (!buf) {
+		fprintf(stderr, "Cannot allocate %lu bytes for PGN buffer\n",
+				(unsigned long) bufsize);
+		close();
+		return false;
+	}
+
+	data = buf;
+	len = pos = 0;
+	at_eof = false;
+	data_at_line_start = true;
+	return true;
+}
+
+void PGNReader::close()
+{
+#ifdef HAVE_MMAP
+	if (mapping) {
+		munmap((void *) mapping, mapping_size);
+	}
+#endif
+	mapping = NULL;
+	mapping_size = 0;
+
+	if (fp) {
+		fclose(fp);
+		fp = NULL;
+	}
+
+	free(buf);
+	buf = NULL;
+	bufsize = 0;
+
+	data = NULL;
+	len = pos = 0;
+	at_eof = true;
+}
+
+/*
+ * Continue reading at the given file offset, which must be the start of
+ * a line.
+ */
+bool PGNReader::seek(long offset)
+{
+	if (mapping) {
+		if (offset < 0 || (size_t) offset > mapping_size) {
+			return false;
+		}
+		pos = offset;
+		return true;
+	} else if (fp) {
+		if (fseek(fp, offset, SEEK_SET) == -1) {
+			return false;
+		}
+		len = pos = 0;
+		at_eof = false;
+		data_at_line_start = true;
+		return true;
+	} else {
+		return false;
+	}
+}
+
+/*
+ * Read the next game.
+ */
+PGNReader::status PGNReader::next()
+{
+	for (;;) {
+		size_t start = pos;
+		int ret = parse_game();
+		if (ret != INCOMPLETE) {
+			return (status) ret;
+		}
+
+		/* The buffer ended within the game. Read more and
+		 * start over. */
+		pos = start;
+		fill();
+	}
+}
+
+std::string PGNReader::get_tag(const char * name) const
+{
+	size_t name_len = strlen(name);
+	for (unsigned int i = 0; i < tags.size(); i++) {
+		if (tags[i].name_len == name_len
+				&& memcmp(tags[i].name, name, name_len) == 0) {
+			return std::string(tags[i].value, tags[i].value_len);
+		}
+	}
+	return "";
+}
+
+/*
+ * Read more data from the file into the buffer. Everything before pos,
+ * except for one character needed by is_line_start(), is discarded.
+ */
+void PGNReader::fill()
+{
+	ASSERT(fp != NULL && buf != NULL);
+
+	if (pos > 0) {
+		size_t keep = pos - 1;
+		memmove(buf, buf + keep, len - keep);
+		len -= keep;
+		pos -= keep;
+		data_at_line_start = false;
+	}
+
+	if (len == bufsize) {
+		/* A single game does not fit into the buffer. */
+		bufsize *= 2;
+		char * newbuf = (char *) realloc(buf, bufsize);
+		if (!newbuf) {
+			fprintf(stderr, "Cannot allocate %lu bytes for"
+					" PGN buffer\n",
+					(unsigned long) bufsize);
+			exit(EXIT_FAILURE);
+		}
+		buf = newbuf;
+		data = buf;
+	}
+
+	size_t n = fread(buf + len, 1, bufsize - len, fp);
+	len += n;
+	if (n == 0) {
+		at_eof = true;
+	}
+}
+
+/*
+ * Character classes for the tokenizer: white space, and characters that
+ * end a SAN token.
+ */
+static class pgn_ctype {
+      public:
+	enum { SPACE = 1, DELIM = 2 };
+	unsigned char t[256];
+
+	pgn_ctype() {
+		memset(t, 0, sizeof(t));
+		t[(unsigned char) ' '] = t[(unsigned char) '\t']
+			= t[(unsigned char) '\n'] = t[(unsigned char) '\r']
+			= SPACE | DELIM;
+		t[(unsigned char) '{'] = t[(unsigned char) '}']
+			= t[(unsigned char) '('] = t[(unsigned char) ')']
+			= t[(unsigned char) ';'] = t[(unsigned char) '$']
+			= DELIM;
+	}
+} pgn_ctype;
+
+#define IS_SPACE(c) (pgn_ctype.t[(unsigned char) (c)] & pgn_ctype::SPACE)
+#define IS_DELIM(c) (pgn_ctype.t[(unsigned char) (c)] & pgn_ctype::DELIM)
+
+/* Return pointer to the first c in [p, end), or end. */
+static inline const char * skip_to(const char * p, const char * end, char c)
+{
+	const char * q = (const char *) memchr(p, c, end - p);
+	return q ? q : end;
+}
+
+/*
+ * Parse the game starting at data[pos]. Returns a PGNReader::status, or
+ * INCOMPLETE if more data is needed.
+ */
+int PGNReader::parse_game()
+{
+	const char * p = data + pos;
+	const char * const end = data + len;
+
+	/* Skip everything up to the next tag section. */
+	while ((p = skip_to(p, end, '[')) < end && !is_line_start(p)) {
+		p++;
+	}
+	if (p == end) {
+		if (!at_eof) {
+			return INCOMPLETE;
+		}
+		pos = len;
+		return NO_MORE_GAMES;
+	}
+
+	/*
+	 * Read all tag lines. A tag is [Name "Value"]; the value may
+	 * contain escaped quotes.
+	 */
+	tags.clear();
+	while (p < end && *p == '[') {
+		struct tag t;
+		p++;
+		while (p < end && IS_SPACE(*p)) {
+			p++;
+		}
+		t.name = p;
+		while (p < end && !IS_SPACE(*p) && *p != '"' && *p != ']') {
+			p++;
+		}
+		t.name_len = p - t.name;
+		while (p < end && *p != '"' && *p != '\n') {
+			p++;
+		}
+		if (p < end && *p == '"') {
+			p++;
+			t.value = p;
+			while (p < end && *p != '"' && *p != '\n') {
+				if (*p == '\\' && p + 1 < end) {
+					p++;
+				}
+				p++;
+			}
+			t.value_len = p - t.value;
+		} else {
+			t.value = p;
+			t.value_len = 0;
+		}
+		tags.push_back(t);
+
+		/* Skip rest of line */
+		p = skip_to(p, end, '\n');
+		if (p == end) {
+			if (!at_eof) {
+				return INCOMPLETE;
+			}
+			break;
+		}
+		p++;
+	}
+
+	bool bad = false;
+	std::string fen = get_tag("FEN");
+	if (fen != "") {
+		if (!opening.parse_fen(fen)) {
+			bad = true;
+		}
+	} else {
+		opening = startpos;
+	}
+
+	/*
+	 * Read the movetext, up to the result or the next tag section.
+	 */
+	Board board = opening;
+	moves.clear();
+	for (;;) {
+		while (p < end && IS_SPACE(*p)) {
+			p++;
+		}
+		if (p == end) {
+			if (!at_eof) {
+				return INCOMPLETE;
+			}
+			break;
+		}
+
+		const char c = *p;
+		if (c == '[' && is_line_start(p)) {
+			/* next game, result was missing */
+			break;
+		} else if (c == '{') {
+			/* comment */
+			p = skip_to(p, end, '}');
+			if (p < end) {
+				p++;
+			} else if (!at_eof) {
+				return INCOMPLETE;
+			}
+		} else if (c == ';' || (c == '%' && is_line_start(p))) {
+			/* comment or escape to end of line */
+			p = skip_to(p, end, '\n');
+		} else if (c == '(') {
+			/* variation, may be nested and contain comments */
+			int level = 0;
+			while (p < end) {
+				if (*p == '(') {
+					level++;
+				} else if (*p == ')') {
+					if (--level == 0) {
+						break;
+					}
+				} else if (*p == '{') {
+					p = skip_to(p, end, '}');
+					if (p == end) {
+						break;
+					}
+				}
+				p++;
+			}
+			if (p < end) {
+				p++;
+			} else if (!at_eof) {
+				return INCOMPLETE;
+			}
+		} else if (c >= '0' && c <= '9') {
+			/* move number or result */
+			const char * q = p;
+			while (q < end && *q >= '0' && *q <= '9') {
+				q++;
+			}
+			if (q < end && *q == '.') {
+				while (q < end && *q == '.') {
+					q++;
+				}
+				p = q;
+				continue;
+			}
+			while (q < end && !IS_DELIM(*q)) {
+				q++;
+			}
+			if (q == end && !at_eof) {
+				return INCOMPLETE;
+			}
+			if ((q - p == 3 && (memcmp(p, "1-0", 3) == 0
+						|| memcmp(p, "0-1", 3) == 0))
+					|| (q - p == 7
+						&& memcmp(p, "1/2-1/2", 7) == 0)) {
+				p = q;
+				break;
+			}
+			/* e.g. castling written with zeros */
+			bad = true;
+			p = q;
+		} else if (c == '*') {
+			/* result */
+			p++;
+			break;
+		} else {
+			/* move, NAG, or annotation symbol */
+			const char * q = p + 1;
+			while (q < end && !IS_DELIM(*q)) {
+				q++;
+			}
+			if (q == end && !at_eof) {
+				return INCOMPLETE;
+			}
+
+			if (c == '$' || c == '!' || c == '?') {
+				/* skip */
+			} else if (!bad) {
+				Move mov = board.parse_san(p, q - p);
+				if (mov) {
+					board.make_move(mov);
+				}
+				if (!mov || !board.is_legal()) {
+					if (debug) {
+						printf("Invalid or illegal"
+							" move in PGN: %.*s\n",
+							(int) (q - p), p);
+					}
+					bad = true;
+				} else {
+					moves.push_back(mov);
+				}
+			}
+			p = q;
+		}
+	}
+
+	pos = p - data;
+	return bad ? GAME_BAD : GAME_OK;
+}
+
+#undef IS_SPACE
+#undef IS_DELIM
+
+
 /******************************************************************************
  *
  * Methods of class EPD 
@@ -27,9 +27,12 @@
 #include "board.h"
 #include "move.h"
 
+#include <stdio.h>
+
 #include <map>
 #include <list>
 #include <string>
+#include <vector>
 
 class PGN {
       private:
@@ -55,6 +58,85 @@ class PGN {
 	static std::list<PGN> parse_all(const char * filename);
 };
 
+/*
+ * Streaming PGN reader for bulk game import. The file is mapped into memory
+ * if possible, otherwise it is read into a large buffer. Games are
+ * tokenized in place, and moves are resolved with Board::parse_san(), so
+ * that no memory is allocated per token or per game (except for games
+ * with a FEN tag). Games are delivered one at a time by next(); the
+ * opening position, moves and tags are valid until the next call.
+ */
+class PGNReader {
+      public:
+	enum status {
+		GAME_OK,	/* game read */
+		GAME_BAD,	/* game skipped due to errors */
+		NO_MORE_GAMES
+	};
+
+      private:
+	struct tag {
+		const char * name;
+		unsigned int name_len;
+		const char * value;
+		unsigned int value_len;
+	};
+
+	/* Returned by parse_game() if the buffer ends within a game. */
+	static const int INCOMPLETE = -1;
+
+	static const size_t BUFSIZE = 1 << 20;
+
+      private:
+	FILE * fp;
+	const char * mapping;
+	size_t mapping_size;
+	char * buf;
+	size_t bufsize;
+
+	/* Current window of the file: data[0..len-1], next game is
+	 * searched at data[pos]. */
+	const char * data;
+	size_t len;
+	size_t pos;
+	bool at_eof;
+	bool data_at_line_start;
+
+	Board startpos;
+	Board opening;
+	std::vector<struct tag> tags;
+	std::vector<Move> moves;
+
+      public:
+	PGNReader();
+	~PGNReader();
+
+      public:
+	bool open(const char * filename);
+	void close();
+	bool seek(long offset);
+	status next();
+
+	const Board & get_opening() const
+	{ return opening; }
+
+	const std::vector<Move> & get_moves() const
+	{ return moves; }
+
+	std::string get_tag(const char * name) const;
+
+      private:
+	int parse_game();
+	void fill();
+	inline bool is_line_start(const char * p) const;
+};
+
+inline bool PGNReader::is_line_start(const char * p) const
+{
+	return (p == data) ? data_at_line_start
+		: (p[-1] == '\n' || p[-1] == '\r');
+}
+
 class EPD {
       private:
 	std::string fen_position;
@@ -25,6 +25,9 @@
 #include "search.h"
 
 #include <stdio.h>
+#include <string.h>
+
+#include <vector>
 
 
 /*****************************************************************************
@@ -33,12 +36,15 @@
  *
  *****************************************************************************/
 
-Search::Search(Shell * shell)
+Search::Search(Shell * shell, Search * master, unsigned int helper_id)
 {
 	this->shell = shell;
 
 	evaluator = new Evaluator();
 	hashtable = NULL;
+	pawnhashtable = NULL;
+	evalcache = NULL;
+	book = NULL;
 	histtable[WHITE] = new HistoryTable();
 	histtable[BLACK] = new HistoryTable();
 
@@ -48,10 +54,30 @@ Search::Search(Shell * shell)
 	maxdepth = MAXDEPTH;
 
 	param_time = 0;
+#ifdef USE_LMR
+	param_lmr = true;
+	param_lmr_depth = 3;
+	param_lmr_moves = 3;
+	param_lmr_div = 225;
+	init_lmr();
+#endif
 	
+	nodes = 0;
+	nodes_quiesce = 0;
+
 	thread = NULL;
 	stop = false;
 
+	this->master = master;
+	this->helper_id = helper_id;
+	nr_helpers = 0;
+	helpers = NULL;
+	smp_mode = SMP_LAZY;
+	pool = NULL;
+	active_root = NULL;
+	nr_splits = 0;
+	active_split = NULL;
+
 	ostat_knodes = 0;
 	ostat_csecs = 0;
 	ostat_depth_sum = 0;
@@ -62,6 +88,19 @@ Search::Search(Shell * shell)
 
 Search::~Search()
 {
+	delete pool;
+	for (unsigned int i=0; i<nr_helpers; i++) {
+		delete helpers[i];
+	}
+	delete[] helpers;
+
+	/* Helpers own their private pawn hash table and evaluation cache,
+	 * see set_pawnhashtable() and set_evalcache(). */
+	if (master) {
+		delete pawnhashtable;
+		delete evalcache;
+	}
+
 	delete evaluator;
 	delete histtable[WHITE];
 	delete histtable[BLACK]; 
@@ -189,6 +228,16 @@ Move Search::get_best()
 	return tmp;
 }
 
+/*
+ * Return the time in centiseconds after which the last search had found
+ * the move returned by get_best(), i.e. the time to solution in a test
+ * suite.
+ */
+unsigned int Search::get_best_time() const
+{
+	return best_time;
+}
+
 void Search::main()
 {
 	DBG(2, "locking main_mutex");
@@ -206,6 +255,11 @@ void Search::main()
 
 	reset_statistics();
 
+	/* Helpers share the master's hash table. */
+	if (hashtable && !master) {
+		hashtable->new_search();
+	}
+
 	histtable[WHITE]->reset();
 	histtable[BLACK]->reset();
 	tree.clear_killer();
@@ -214,6 +268,7 @@ void Search::main()
 	 * move as best, in case search terminates without choosing a move. */
 	tree.set_root(game->get_board());
 	rootdepth = 0;
+	best_time = 0;
 	const Board & rootboard = tree.get_rootboard();
 	int rooteval = evaluator->eval(rootboard, -INFTY, INFTY, myside);
 	
@@ -257,7 +312,9 @@ void Search::main()
 			print_result(0, rooteval, '.');
 		}
 	} else {
+		start_helpers();
 		iterate();
+		stop_helpers();
 	}
 
 	if (verbose || (showthinking && !shell->xboard)) {
@@ -273,6 +330,116 @@ void Search::main()
 	DBG(2, "unlocked main_mutex");
 }
 
+/*****************************************************************************
+ *
+ * Helper threads.
+ *
+ * In lazy SMP mode (the default), the helpers run iterate() on their own
+ * tree, history tables and evaluator. The only thing they share with the
+ * main thread is the hash table, through which they speed up the main
+ * thread's search. The helpers never check time themselves, they are
+ * stopped by the main thread as soon as it has finished its own search,
+ * and only the main thread's result is used.
+ *
+ * In root-parallel and split-point (YBWC) mode, the helpers have no thread
+ * of their own. They search root moves for the main thread, see
+ * search_root_split(), or help at split points, see split().
+ *
+ *****************************************************************************/
+
+void Search::start_helpers()
+{
+	for (unsigned int i=0; i<nr_helpers; i++) {
+		Search * helper = helpers[i];
+		ASSERT(!helper->thread);
+
+		helper->hashtable = hashtable;
+		helper->game = game;
+		helper->mode = ANALYZE;
+		helper->myside = myside;
+		helper->maxdepth = maxdepth;
+#ifdef USE_LMR
+		helper->param_lmr = param_lmr;
+		helper->param_lmr_depth = param_lmr_depth;
+		helper->param_lmr_moves = param_lmr_moves;
+		helper->param_lmr_div = param_lmr_div;
+		memcpy(helper->lmr_reduction, lmr_reduction,
+				sizeof(lmr_reduction));
+#endif
+		helper->smp_mode = smp_mode;
+		helper->stop = false;
+		if (smp_mode == SMP_LAZY) {
+			helper->thread = new Thread(helper_thread_main);
+			helper->thread->start(helper);
+		} else {
+			helper->helper_begin();
+		}
+	}
+}
+
+void Search::stop_helpers()
+{
+	/* Run the remaining tasks for split points, which have all been
+	 * closed by now, so that no helper is left in a task. */
+	if (pool && smp_mode == SMP_YBWC) {
+		pool->wait();
+	}
+
+	for (unsigned int i=0; i<nr_helpers; i++) {
+		helpers[i]->stop = true;
+	}
+
+	for (unsigned int i=0; i<nr_helpers; i++) {
+		Search * helper = helpers[i];
+		if (smp_mode == SMP_LAZY) {
+			helper->thread->wait();
+			delete helper->thread;
+			helper->thread = NULL;
+		} else {
+			helper->helper_end();
+		}
+		helper->game = NULL;
+	}
+}
+
+void * Search::helper_thread_main(void * arg)
+{
+	Search * search = (Search *) arg;
+	search->helper_main();
+	return NULL;
+}
+
+void Search::helper_main()
+{
+	helper_begin();
+	iterate();
+	helper_end();
+}
+
+void Search::helper_begin()
+{
+	ASSERT(master != NULL);
+
+	clock = new Clock();
+	clock->start();
+	next_timecheck = TIMECHECK_INTERVAL;
+	next_update = 0;
+
+	reset_statistics();
+
+	histtable[WHITE]->reset();
+	histtable[BLACK]->reset();
+	tree.clear_killer();
+
+	tree.set_root(game->get_board());
+}
+
+void Search::helper_end()
+{
+	delete clock;
+	clock = NULL;
+}
+
 /*****************************************************************************
  *
  * Tree Search Functions.
@@ -282,13 +449,21 @@ void Search::main()
 /* Aspiration window for iterative deepening */
 #define WINDOW	50
 
+/* Minimum remaining depth of a split point. Splitting nodes closer to the
+ * leaves costs more than the helpers could save. */
+#define SPLIT_MIN_DEPTH	4
+
 void Search::iterate()
 {
 	int score;
 	int alpha = -INFTY;
 	int beta = INFTY;
+
+	/* Every second helper thread starts one ply deeper, so that the
+	 * threads are not all searching the same depth at the same time. */
+	int startdepth = 1 + helper_id % 2;
 	
-	for (rootdepth = 1; rootdepth <= maxdepth; rootdepth++) {
+	for (rootdepth = startdepth; rootdepth <= maxdepth; rootdepth++) {
 		maxplyreached = 0;
 		maxplyreached_quiesce = 0;
 
@@ -361,6 +536,10 @@ int Search::search_root(unsigned int ply, int depth, int alpha, int beta)
 
 //	DBG(3, "depth=%d, alpha=%d, beta=%d\n", depth, alpha, beta);
 	
+	if (pool && smp_mode == SMP_ROOT) {
+		return search_root_split(ply, depth, alpha, beta);
+	}
+
 	Node * node = tree[ply];
 	
 	int score;
@@ -409,6 +588,9 @@ int Search::search_root(unsigned int ply, int depth, int alpha, int beta)
 		
 		if (score > alpha) {
 			alpha = score;
+			if (mov != node->get_best()) {
+				best_time = clock->get_elapsed_time();
+			}
 			node->set_best(mov);
 			if (showthinking) {
 				print_result(depth, score, ' ');
@@ -430,7 +612,7 @@ int Search::search_root(unsigned int ply, int depth, int alpha, int beta)
 	stat_moves_cnt++;
 #endif
 
-	if (!shell->xboard) {
+	if (!master && !shell->xboard) {
 		clear_line();
 	}
 
@@ -438,6 +620,255 @@ int Search::search_root(unsigned int ply, int depth, int alpha, int beta)
 	return alpha;
 }
 
+/*
+ * Root-parallel search. The first root move is searched by the main thread
+ * alone, to get a bound for the others. The other moves are distributed
+ * among the main thread and the helpers, which take over each other's
+ * moves when they run out of work. They are searched with a null window
+ * around the best score found so far by any thread, and re-searched with
+ * the full window if they fail high.
+ */
+int Search::search_root_split(unsigned int ply, int depth, int alpha, int beta)
+{
+	ASSERT_DEBUG(ply == 0);
+	ASSERT_DEBUG(pool && pool->size() == nr_helpers + 1);
+
+	Node * node = tree[ply];
+
+	struct root_split sp;
+	sp.master = this;
+	sp.depth = depth;
+	sp.alpha = alpha;
+	sp.beta = beta;
+	sp.cutoff = false;
+
+	/* pick() puts every move to its final position in the move list
+	 * when it is returned, so the moves can be scored by position. */
+	std::vector<struct root_move> moves;
+	for (Move mov = node->first(); mov; mov = node->next()) {
+		struct root_move rm;
+		rm.split = &sp;
+		rm.move = mov;
+		rm.move_no = node->get_current_move_no();
+		rm.first = moves.empty();
+		moves.push_back(rm);
+	}
+
+	search_root_move(moves[0]);
+
+	if (!stop && !sp.cutoff) {
+		for (unsigned int i=1; i<moves.size(); i++) {
+			pool->submit(i % pool->size(), root_move_task,
+					&moves[i]);
+		}
+		pool->wait();
+	}
+
+	if (sp.cutoff) {
+		STAT_INC(stat_cut);
+	}
+
+	/* Update history table */
+#ifdef USE_HISTORY
+	histtable[tree.get_board().get_side()]->add(node->get_best());
+#endif
+
+#ifdef COLLECT_STATISTICS
+	stat_moves_sum += moves.size();
+	stat_moves_cnt++;
+#endif
+
+	if (!shell->xboard) {
+		clear_line();
+	}
+
+	return sp.alpha;
+}
+
+void Search::root_move_task(void * arg, unsigned int worker)
+{
+	const struct root_move * rm = (const struct root_move *) arg;
+	Search * master = rm->split->master;
+	Search * search = (worker == 0) ? master : master->helpers[worker-1];
+	search->search_root_move(*rm);
+}
+
+/*
+ * Search a root move for search_root_split(), in the main thread or in a
+ * helper, and merge the result into the main thread's root node.
+ */
+void Search::search_root_move(const struct root_move & rm)
+{
+	struct root_split * sp = rm.split;
+	Search * m = sp->master;
+
+	if (this != m) {
+		stop = false;
+		rootdepth = sp->depth;
+	}
+	if (m->stop || sp->cutoff) {
+		return;
+	}
+
+	const int depth = sp->depth;
+	const int beta = sp->beta;
+	sp->mutex.lock();
+	int alpha = sp->alpha;
+	sp->mutex.unlock();
+	int score;
+
+	active_root = sp;
+	tree.make_move(rm.move);
+#ifdef USE_PVS
+	if (rm.first) {
+		score = -search(1, depth-1, 0, -beta, -alpha);
+	} else {
+		score = -search(1, depth-1, 0, -alpha-1, -alpha);
+		if (!aborted() && score > alpha && score < beta) {
+			/* Another thread may have raised alpha meanwhile. */
+			sp->mutex.lock();
+			alpha = sp->alpha;
+			sp->mutex.unlock();
+			score = -search(1, depth-1, 0, -beta, -alpha);
+		}
+	}
+#else
+	score = -search(1, depth-1, 0, -beta, -alpha);
+#endif
+	tree.unmake_move();
+	const bool abort = aborted();
+	active_root = NULL;
+
+	if (abort) {
+		return;
+	}
+
+	sp->mutex.lock();
+	Node * root = m->tree[0];
+	root->set_move_score(rm.move_no, score);
+	if (score > sp->alpha && !sp->cutoff) {
+		sp->alpha = score;
+		if (rm.move != root->get_best()) {
+			m->best_time = m->clock->get_elapsed_time();
+		}
+		root->set_best(rm.move);
+		if (m->showthinking) {
+			m->print_result(depth, score, ' ');
+		}
+		if (score >= beta) {
+			/* The other moves do not matter any more. All
+			 * threads that are searching one of them, the main
+			 * thread included, see this in aborted(). */
+			sp->cutoff = true;
+		}
+	}
+	sp->mutex.unlock();
+}
+
+/*
+ * Search the move mov of node ply, which has just been made and is the
+ * moves-th legal move of the node, for search() or split_loop(). Returns
+ * false if the move is pruned, otherwise its score is stored in *score.
+ */
+inline bool Search::search_move(unsigned int ply, Move mov, int moves,
+		bool first, const Node * node, const Node * cnode,
+		const struct node_params & np, int alpha, int beta, int * score)
+{
+	const int depth = np.depth;
+	const int extend = np.extend;
+
+#ifdef USE_FUTILITYPRUNING
+	/* Futility pruning */
+	if (np.fprune && !node->in_check() && !cnode->in_check()
+			&& !mov.is_capture()
+#ifdef HOICHESS
+			&& !mov.is_enpassant()
+			&& !mov.is_promotion()
+#endif // HOICHESS
+			) {
+		STAT_INC(stat_futcut);
+		return false;
+	}
+#endif // USE_FUTILITYPRUNING
+
+#ifdef USE_PVS
+	/* Search the current move. We use a standard
+	 * principal variation search here. */
+	if (first) {
+		*score = -search(ply+1, depth-1, extend, -beta, -alpha);
+	} else {
+		bool full = true;
+#ifdef USE_LMR
+		/* Late move reductions: Search late quiet moves
+		 * with reduced depth first, and only if they
+		 * unexpectedly fail high, search them again with
+		 * full depth. */
+		if (np.lmr_ok && moves > (int) param_lmr_moves
+				&& !cnode->in_check()
+				&& !mov.is_capture()
+#ifdef HOICHESS
+				&& !mov.is_enpassant()
+				&& !mov.is_promotion()
+#endif // HOICHESS
+				&& !node->is_killer(mov)) {
+			int r = lmr_reduction[MIN(depth, 63)]
+				[MIN(moves, 63)];
+			if (r > depth - 2) {
+				r = depth - 2;
+			}
+			if (r > 0) {
+				STAT_INC(stat_lmr);
+				*score = -search(ply+1, depth-1-r, extend,
+						-alpha-1, -alpha);
+				if (*score > alpha) {
+					STAT_INC(stat_lmr_research);
+				} else {
+					full = false;
+				}
+			}
+		}
+#endif // USE_LMR
+		if (full) {
+			*score = -search(ply+1, depth-1, extend,
+					-alpha-1, -alpha);
+			if (*score > alpha && *score < beta) {
+				*score = -search(ply+1, depth-1, extend,
+						-beta, -alpha);
+			}
+		}
+	}
+#else
+	/* Search the current move. We use a pure
+	 * alpha-beta search here. */
+	(void) first;
+	*score = -search(ply+1, depth-1, extend, -beta, -alpha);
+#endif
+
+	return true;
+}
+
+/*
+ * True if the search has to be aborted, because it was stopped or because
+ * the root split or one of the split points it works for has already got
+ * a cutoff.
+ */
+inline bool Search::aborted() const
+{
+	if (stop) {
+		return true;
+	}
+	if (active_root && active_root->cutoff) {
+		return true;
+	}
+	for (const struct split_point * sp = active_split; sp;
+			sp = sp->parent) {
+		if (sp->cutoff) {
+			return true;
+		}
+	}
+	return false;
+}
+
 int Search::search(unsigned int ply, int depth, int extend, int alpha, int beta)
 {
 	ASSERT_DEBUG(tree.get_current_ply() == ply);
@@ -584,6 +1015,20 @@ int Search::search(unsigned int ply, int depth, int extend, int alpha, int beta)
 		extend = 0;
 	}
 
+	/* Parameters for search_move() */
+	struct node_params np;
+	np.depth = depth;
+	np.extend = extend;
+	np.fprune = false;
+	np.lmr_ok = false;
+#ifdef USE_FUTILITYPRUNING
+	np.fprune = fprune;
+#endif
+#ifdef USE_LMR
+	np.lmr_ok = param_lmr && depth >= (int) param_lmr_depth
+		&& !node->in_check();
+#endif
+
 	/*
 	 * Search all successor moves.
 	 */
@@ -595,49 +1040,29 @@ int Search::search(unsigned int ply, int depth, int extend, int alpha, int beta)
 		}
 		moves++;
 
-#ifdef USE_FUTILITYPRUNING
-		/* Futility pruning */
-		if (fprune && !node->in_check() && !cnode->in_check()
-				&& !mov.is_capture()
-#ifdef HOICHESS
-				&& !mov.is_enpassant()
-				&& !mov.is_promotion()
-#endif // HOICHESS
-				) {
-			STAT_INC(stat_futcut);
-			tree.unmake_move();
-			continue;
-		}
-#endif // USE_FUTILITYPRUNING
-		
+		bool searched = search_move(ply, mov, moves,
 #ifdef USE_PVS
-		/* Search the current move. We use a standard
-		 * principal variation search here. */
-		if (first) {
-			score = -search(ply+1, depth-1, extend, -beta, -alpha);
-			first = false;
-		} else {
-			score = -search(ply+1, depth-1, extend,
-					-alpha-1, -alpha);
-			if (score > alpha && score < beta) {
-				score = -search(ply+1, depth-1, extend,
-						-beta, -alpha);
-			}			
-		}
+				first,
 #else
-		/* Search the current move. We use a pure
-		 * alpha-beta search here. */
-		score = -search(ply+1, depth-1, extend, -beta, -alpha);
+				false,
 #endif
+				node, cnode, np, alpha, beta, &score);
 
 		tree.unmake_move();
 
+		if (!searched) {
+			continue;
+		}
+#ifdef USE_PVS
+		first = false;
+#endif
+
 		if (nodes >= next_timecheck) {
 			check_time();
 			next_timecheck = nodes + TIMECHECK_INTERVAL;
 		}
 
-		if (stop) {
+		if (aborted()) {
 			return alpha;
 		}
 
@@ -649,6 +1074,16 @@ int Search::search(unsigned int ply, int depth, int extend, int alpha, int beta)
 				break;
 			}
 		}
+
+		/* Young brothers wait: Now that one move has been searched
+		 * without a cutoff, idle threads may help with the others. */
+		if (smp_mode == SMP_YBWC && depth >= SPLIT_MIN_DEPTH
+				&& can_split()) {
+			if (!split(ply, np, &alpha, beta, &moves)) {
+				return alpha;
+			}
+			break;
+		}
 	}
 
 	/* Test for checkmate or stalemate */
@@ -711,6 +1146,259 @@ int Search::search(unsigned int ply, int depth, int extend, int alpha, int beta)
 	return alpha;
 }
 
+/*****************************************************************************
+ *
+ * Split-point search (Young Brothers Wait Concept).
+ *
+ * When a node of search() has searched its first move without a cutoff
+ * and some helpers are idle, it becomes a split point: the remaining moves
+ * of the node are generated and ordered by its owner, then the helpers
+ * join it and take moves from that list, while the owner keeps searching
+ * moves as well. Each thread searches its moves on its own tree, which
+ * continues the owner's path to the split point. A cutoff at a split point
+ * aborts the searches of all threads below it, see aborted().
+ *
+ * The owner returns from the node only after all helpers have left it.
+ * Until then, it helps at split points that its helpers create below it
+ * ("helpful master"). This is how the main thread, which gets no tasks
+ * from the pool, works at the split points of others.
+ *
+ * Unlike the single-threaded search, the search of several threads is
+ * not deterministic: which thread searches which move, and with which
+ * bound, depends on timing.
+ *
+ *****************************************************************************/
+
+/*
+ * True if the current node may be split, i.e. some helpers are idle, or
+ * the owner of a split point above waits for its helpers.
+ */
+bool Search::can_split() const
+{
+	const Search * root = master ? master : this;
+	if (nr_splits >= MAX_SPLITS || !root->pool) {
+		return false;
+	} else if (root->pool->get_idle() > 0) {
+		return true;
+	}
+
+	for (struct split_point * sp = active_split; sp; sp = sp->parent) {
+		sp->mutex.lock();
+		const bool waiting = sp->waiting;
+		sp->mutex.unlock();
+		if (waiting) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Turn node ply into a split point and search its remaining moves together
+ * with the idle helpers. alpha, the best move of the node and the number
+ * of moves are updated. Returns false if the search has been aborted.
+ */
+bool Search::split(unsigned int ply, const struct node_params & np,
+		int * alpha, int beta, int * moves)
+{
+	ASSERT_DEBUG(nr_splits < MAX_SPLITS);
+	struct split_point * sp = &split_points[nr_splits++];
+
+	sp->mutex.lock();
+	sp->owner = this;
+	sp->parent = active_split;
+	sp->node = tree[ply];
+	sp->board = tree.get_board();
+	sp->ply = ply;
+	sp->params = np;
+	sp->alpha = *alpha;
+	sp->beta = beta;
+	sp->cutoff = false;
+	sp->moves = *moves;
+	sp->best = NO_MOVE;
+	sp->helpers = 0;
+	sp->waiting = false;
+	sp->join = NULL;
+
+	/* The move ordering uses this thread's history table, so the moves
+	 * are taken from the node here, not by the helpers. */
+	sp->movelist.clear();
+	for (Move mov = sp->node->next(); mov; mov = sp->node->next()) {
+		sp->movelist.add(mov);
+	}
+	sp->next_move = 0;
+	sp->open = true;
+	sp->mutex.unlock();
+
+	/* The main thread (worker 0) is busy with its own search. It only
+	 * helps as the owner of a split point above this one, see below. */
+	ThreadPool * pool = (master ? master : this)->pool;
+	const unsigned int n = pool->get_idle();
+	for (unsigned int i=0; i<n; i++) {
+		pool->submit(1 + i % (pool->size() - 1), split_task, sp);
+	}
+
+	for (struct split_point * p = sp->parent; p; p = p->parent) {
+		p->mutex.lock();
+		if (p->waiting && !p->join) {
+			p->join = sp;
+			p->cond.broadcast();
+		}
+		p->mutex.unlock();
+	}
+
+	active_split = sp;
+	split_loop(sp);
+	active_split = sp->parent;
+
+	/* Helpers that have not joined yet must not do so any more. While
+	 * the others finish their moves, help them at their split points. */
+	sp->mutex.lock();
+	sp->open = false;
+	while (sp->helpers > 0) {
+		if (sp->join) {
+			struct split_point * join = sp->join;
+			sp->join = NULL;
+			sp->mutex.unlock();
+
+			help_split(join, sp);
+			tree.copy_path(tree, ply, sp->board);
+
+			sp->mutex.lock();
+		} else {
+			sp->waiting = true;
+			sp->cond.wait(sp->mutex);
+			sp->waiting = false;
+		}
+	}
+	sp->join = NULL;
+	sp->mutex.unlock();
+	nr_splits--;
+
+	*moves = sp->moves;
+	if (sp->best) {
+		*alpha = sp->alpha;
+		tree[ply]->set_best(sp->best);
+	}
+	if (sp->cutoff) {
+		STAT_INC(stat_cut);
+	}
+	STAT_INC(stat_splits);
+
+	return !aborted();
+}
+
+void Search::split_task(void * arg, unsigned int worker)
+{
+	struct split_point * sp = (struct split_point *) arg;
+	Search * root = sp->owner->master ? sp->owner->master : sp->owner;
+	Search * search = (worker == 0) ? root : root->helpers[worker-1];
+	search->help_split(sp);
+}
+
+/*
+ * Join the split point, if it is still open, and help the owner until
+ * there are no moves left. Tasks for split points that have already been
+ * closed, or reused for another node, are harmless. The owner of a split
+ * point may only help below it, because its tree must still continue the
+ * same path, so it gives its own split point as below.
+ */
+void Search::help_split(struct split_point * sp,
+		const struct split_point * below)
+{
+	sp->mutex.lock();
+	bool join = sp->open && !sp->cutoff;
+	if (join && below) {
+		const struct split_point * p = sp->parent;
+		while (p && p != below) {
+			p = p->parent;
+		}
+		join = (p != NULL);
+	}
+	if (!join) {
+		sp->mutex.unlock();
+		return;
+	}
+	ASSERT_DEBUG(sp->owner != this);
+	sp->helpers++;
+	tree.copy_path(sp->owner->tree, sp->ply, sp->board);
+	sp->mutex.unlock();
+
+	struct split_point * save = active_split;
+	active_split = sp;
+	split_loop(sp);
+	active_split = save;
+
+	sp->mutex.lock();
+	if (--sp->helpers == 0) {
+		sp->cond.broadcast();
+	}
+	sp->mutex.unlock();
+}
+
+/*
+ * Search moves of the split point until there are none left, run by the
+ * owner and by the helpers. Like in search(), a move is searched with the
+ * bound that is known when it is started.
+ */
+void Search::split_loop(struct split_point * sp)
+{
+	const unsigned int ply = sp->ply;
+	ASSERT_DEBUG(tree.get_current_ply() == ply);
+
+	for (;;) {
+		sp->mutex.lock();
+		Move mov = NO_MOVE;
+		if (!sp->cutoff && sp->next_move < sp->movelist.size()) {
+			mov = sp->movelist[sp->next_move++];
+		}
+		sp->mutex.unlock();
+		if (!mov) {
+			break;
+		}
+
+		Node * cnode = tree.make_move(mov);
+		if (!tree.get_board().is_legal()) {
+			tree.unmake_move();
+			continue;
+		}
+
+		sp->mutex.lock();
+		const int moves = ++sp->moves;
+		const int alpha = sp->alpha;
+		sp->mutex.unlock();
+
+		int score;
+		bool searched = search_move(ply, mov, moves, false, sp->node,
+				cnode, sp->params, alpha, sp->beta, &score);
+
+		tree.unmake_move();
+
+		if (!searched) {
+			continue;
+		}
+
+		if (nodes >= next_timecheck) {
+			check_time();
+			next_timecheck = nodes + TIMECHECK_INTERVAL;
+		}
+
+		if (aborted()) {
+			break;
+		}
+
+		sp->mutex.lock();
+		if (score > sp->alpha && !sp->cutoff) {
+			sp->alpha = score;
+			sp->best = mov;
+			if (score >= sp->beta) {
+				sp->cutoff = true;
+			}
+		}
+		sp->mutex.unlock();
+	}
+}
+
 int Search::quiescence_search(unsigned int ply, int alpha, int beta)
 {
 	ASSERT_DEBUG(tree.get_current_ply() == ply);
@@ -864,6 +1552,18 @@ void Search::check_time()
 		stop = true;
 	}
 
+	/* In root-parallel and split-point mode, the main thread may be
+	 * waiting for the helpers to finish their moves, so they have to
+	 * watch its time. */
+	if (master && smp_mode != SMP_LAZY) {
+		if (master->mode == MOVE && master->clock->timeout()) {
+			master->stop = true;
+		}
+		if (master->stop) {
+			stop = true;
+		}
+	}
+
 	if (showthinking  &&  clock->get_elapsed_time() >= next_update) {
 		print_thinking(rootdepth);
 	}
@@ -50,6 +50,7 @@ class Search
 		PARAM_TIME_NB = 0x04,
 		PARAM_TIME_FH = 0x08
 	};
+	enum smp_modes { SMP_LAZY, SMP_ROOT, SMP_YBWC };
 		
       private:
 	Shell * shell;
@@ -57,6 +58,8 @@ class Search
 	/* external data structures */
 	Evaluator * evaluator;
 	HashTable * hashtable;
+	PawnHashTable * pawnhashtable;
+	EvaluationCache * evalcache;
 	HistoryTable * histtable[2];
 	Book * book;
 	
@@ -67,6 +70,7 @@ class Search
 	/* tree */
 	Tree tree;
 	int rootdepth;
+	unsigned int best_time;
 	int maxdepth;
 
 	unsigned int maxplyreached;
@@ -78,12 +82,87 @@ class Search
 	
 	/* parameters */
 	unsigned long param_time;
+#ifdef USE_LMR
+	bool param_lmr;
+	unsigned int param_lmr_depth;
+	unsigned int param_lmr_moves;
+	unsigned int param_lmr_div;
+	unsigned char lmr_reduction[64][64];
+#endif
 	
 	/* thread/control stuff */
 	Mutex start_mutex;
 	Mutex main_mutex;
 	Thread * thread;
 	bool stop;
+
+	/* helper threads, they all share the main hash table */
+	Search * master;
+	unsigned int helper_id;
+	unsigned int nr_helpers;
+	Search ** helpers;
+	enum smp_modes smp_mode;
+
+	/* Root-parallel and split-point search: the main thread and the
+	 * helpers are the workers of the pool, the root moves or requests to
+	 * help at a split point are its tasks. */
+	ThreadPool * pool;
+	struct root_split {
+		Mutex mutex;
+		Search * master;
+		int depth;
+		volatile int alpha;
+		int beta;
+		volatile bool cutoff;
+	};
+	struct root_move {
+		struct root_split * split;
+		Move move;
+		unsigned int move_no;
+		bool first;
+	};
+	/* The root split whose move this thread is searching, see
+	 * aborted(). */
+	const struct root_split * active_root;
+
+	/* Parameters of a node in search() that are the same for all of
+	 * its moves, see search_move(). */
+	struct node_params {
+		int depth;
+		int extend;
+		bool fprune;
+		bool lmr_ok;
+	};
+
+	/* Split point of the YBWC search: a node of the owner's tree whose
+	 * remaining moves are searched by the owner and the helpers that
+	 * have joined, see split(). The split points of a thread are nested,
+	 * the deepest one is active_split. */
+	enum { MAX_SPLITS = 8 };
+	struct split_point {
+		Mutex mutex;
+		Condition cond;
+		bool open;
+		unsigned int helpers;
+		bool waiting;		/* owner waits for the helpers */
+		struct split_point * join;	/* where the owner may help */
+		Search * owner;
+		struct split_point * parent;
+		Node * node;
+		Board board;
+		unsigned int ply;
+		struct node_params params;
+		Movelist movelist;	/* remaining moves, in order */
+		unsigned int next_move;
+		volatile int alpha;
+		int beta;
+		volatile bool cutoff;
+		int moves;
+		Move best;
+	};
+	struct split_point split_points[MAX_SPLITS];
+	unsigned int nr_splits;
+	struct split_point * active_split;
 	
 	/* required for time control and basic statistics */
 	unsigned long nodes;
@@ -98,6 +177,9 @@ class Search
 	unsigned long stat_futcut;
 	unsigned long stat_xfutcut;
 	unsigned long stat_razcut;
+	unsigned long stat_lmr;
+	unsigned long stat_lmr_research;
+	unsigned long stat_splits;
 	unsigned long stat_moves_sum;
 	unsigned long stat_moves_cnt;
 	unsigned long stat_moves_sum_quiesce;
@@ -114,7 +196,8 @@ class Search
 	bool showthinking;
 	
       public:
-	Search(Shell * shell);
+	Search(Shell * shell, Search * master = NULL,
+			unsigned int helper_id = 0);
 	~Search();
 	
       public:
@@ -126,26 +209,56 @@ class Search
 
 	void interrupt();
 	Move get_best();
+	unsigned int get_best_time() const;
 	void set_book(Book * book);
 	void set_depthlimit(unsigned int depth);
 	void set_hashtable(HashTable * hashtable);
 	void set_pawnhashtable(PawnHashTable * pawnhashtable);
 	void set_evalcache(EvaluationCache * evalcache);
+	void clear_tables();
 	void set_showthinking(bool x);
+	void set_threads(unsigned int n);
+	unsigned int get_threads() const;
+	unsigned int get_depthlimit() const;
+	unsigned long get_nodes() const;
 	Evaluator * get_evaluator() const;
 	void set_param(const std::string& name, const std::string& value);
 	
       private:
 	void main();
+	void start_helpers();
+	void stop_helpers();
+	void update_pool();
+	static void * helper_thread_main(void * arg);
+	void helper_main();
+	void helper_begin();
+	void helper_end();
 	void iterate();
 	int search_root(unsigned int ply, int depth, int alpha, int beta);
+	int search_root_split(unsigned int ply, int depth,
+			int alpha, int beta);
+	static void root_move_task(void * arg, unsigned int worker);
+	void search_root_move(const struct root_move & rm);
 	int search(unsigned int ply, int depth, int extend,
 			int alpha, int beta);
+	inline bool search_move(unsigned int ply, Move mov, int moves,
+			bool first, const Node * node, const Node * cnode,
+			const struct node_params & np, int alpha, int beta,
+			int * score);
+	inline bool aborted() const;
+	bool can_split() const;
+	bool split(unsigned int ply, const struct node_params & np,
+			int * alpha, int beta, int * moves);
+	static void split_task(void * arg, unsigned int worker);
+	void help_split(struct split_point * sp,
+			const struct split_point * below = NULL);
+	void split_loop(struct split_point * sp);
 	int quiescence_search(unsigned int ply, int alpha, int beta);
 
 	bool is_draw();
 
       private:
+	void init_lmr();
 	void check_time();
 	void reset_statistics();
 	void print_statistics();
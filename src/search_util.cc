@@ -25,6 +25,7 @@
 #include "clock.h"
 #include "search.h"
 
+#include <math.h>
 #include <stdio.h>
 
 #include <sstream>
@@ -63,10 +64,30 @@ void Search::print_statistics()
 	printf(" (%.0fk nodes/s)\n",
 			nodes_total / ((float) csecs / 100) / 1000);
 
+	if (nr_helpers > 0) {
+		unsigned long nodes_all = get_nodes();
+		printf("Nodes searched by all %u threads: %lu"
+				" (%.0fk nodes/s)\n",
+				nr_helpers + 1, nodes_all,
+				nodes_all / ((float) csecs / 100) / 1000);
+	}
+
 #ifdef COLLECT_STATISTICS
 	printf("Cutoffs: beta: %ld, null: %ld, fut: %ld/%ld, razor: %ld\n",
 			stat_cut, stat_nullcut,
 			stat_futcut, stat_xfutcut, stat_razcut);
+	printf("Late move reductions: %ld, re-searched: %ld (%u%%)\n",
+			stat_lmr, stat_lmr_research,
+			stat_lmr > 0
+				? (unsigned) (100 * stat_lmr_research / stat_lmr)
+				: 0);
+	if (smp_mode == SMP_YBWC) {
+		unsigned long splits = stat_splits;
+		for (unsigned int i=0; i<nr_helpers; i++) {
+			splits += helpers[i]->stat_splits;
+		}
+		printf("Split points of all threads: %ld\n", splits);
+	}
 	
 	if (stat_moves_cnt > 0) {
 		printf("Average branching factor in full-width search: %.2f\n",
@@ -95,13 +116,18 @@ void Search::reset_statistics()
 	stat_futcut = 0;
 	stat_xfutcut = 0;
 	stat_razcut = 0;
+	stat_lmr = 0;
+	stat_lmr_research = 0;
+	stat_splits = 0;
 	stat_moves_sum = 0;
 	stat_moves_cnt = 0;
 	stat_moves_sum_quiesce = 0;
 	stat_moves_cnt_quiesce = 0;
 #endif // COLLECT_STATISTICS
 
-	if (hashtable) {
+	/* The hash table is shared with the helper threads, its
+	 * statistics belong to the main thread. */
+	if (hashtable && !master) {
 		hashtable->reset_statistics();
 	}
 	evaluator->reset_statistics();
@@ -388,6 +414,12 @@ std::string Search::get_best_line(unsigned int depth, char c) const
 
 void Search::clear_line()
 {
+	/* Without thinking output there is nothing to clear, and the
+	 * sequence would garble other output, e.g. of parallel solve. */
+	if (!showthinking) {
+		return;
+	}
+
 	std::string s(79, ' ');
 	atomic_printf("\r%s\r", s.c_str());
 }
@@ -419,14 +451,69 @@ void Search::set_hashtable(HashTable * hashtable)
 	this->hashtable = hashtable;
 }
 
+/*
+ * Pawn hash table and evaluation cache are not thread-safe. Therefore each
+ * helper thread gets its own private table of the same size as the main
+ * thread's one.
+ */
 void Search::set_pawnhashtable(PawnHashTable * pawnhashtable)
 {
-	evaluator->set_pawnhashtable(pawnhashtable);
+	if (master) {
+		delete this->pawnhashtable;
+		this->pawnhashtable = pawnhashtable
+			? new PawnHashTable(pawnhashtable->get_size())
+			: NULL;
+	} else {
+		this->pawnhashtable = pawnhashtable;
+		for (unsigned int i=0; i<nr_helpers; i++) {
+			helpers[i]->set_pawnhashtable(pawnhashtable);
+		}
+	}
+
+	evaluator->set_pawnhashtable(this->pawnhashtable);
 }
 
 void Search::set_evalcache(EvaluationCache * evalcache)
 {
-	evaluator->set_evalcache(evalcache);
+#ifdef USE_EVALCACHE
+	if (master) {
+		delete this->evalcache;
+		this->evalcache = evalcache
+			? new EvaluationCache(evalcache->get_size())
+			: NULL;
+	} else {
+		this->evalcache = evalcache;
+		for (unsigned int i=0; i<nr_helpers; i++) {
+			helpers[i]->set_evalcache(evalcache);
+		}
+	}
+#endif
+
+	evaluator->set_evalcache(this->evalcache);
+}
+
+/*
+ * Clear the hash table, pawn hash table, evaluation cache and history
+ * tables, including the helpers' private ones, so that the next search
+ * does not depend on earlier ones.
+ */
+void Search::clear_tables()
+{
+	if (hashtable && !master) {
+		hashtable->clear();
+	}
+	if (pawnhashtable) {
+		pawnhashtable->clear();
+	}
+	if (evalcache) {
+		evalcache->clear();
+	}
+	histtable[WHITE]->reset();
+	histtable[BLACK]->reset();
+
+	for (unsigned int i=0; i<nr_helpers; i++) {
+		helpers[i]->clear_tables();
+	}
 }
 
 void Search::set_showthinking(bool x)
@@ -434,6 +521,79 @@ void Search::set_showthinking(bool x)
 	showthinking = x;
 }
 
+/*
+ * Set the number of search threads, i.e. the main thread plus n-1 helper
+ * threads. Must not be called while a search is running.
+ */
+void Search::set_threads(unsigned int n)
+{
+	ASSERT(!master);
+	ASSERT(!thread);
+
+	if (n < 1) {
+		n = 1;
+	} else if (n > MAXTHREADS) {
+		n = MAXTHREADS;
+	}
+
+	for (unsigned int i=0; i<nr_helpers; i++) {
+		delete helpers[i];
+	}
+	delete[] helpers;
+	helpers = NULL;
+
+	nr_helpers = n - 1;
+	if (nr_helpers > 0) {
+		helpers = new Search * [nr_helpers];
+		for (unsigned int i=0; i<nr_helpers; i++) {
+			helpers[i] = new Search(shell, this, i+1);
+			helpers[i]->set_pawnhashtable(pawnhashtable);
+			helpers[i]->set_evalcache(evalcache);
+		}
+	}
+
+	update_pool();
+}
+
+/*
+ * The thread pool is only needed for root-parallel and split-point search
+ * with helpers.
+ */
+void Search::update_pool()
+{
+	const bool need = (smp_mode != SMP_LAZY && nr_helpers > 0);
+	if (pool && (!need || pool->size() != nr_helpers + 1)) {
+		delete pool;
+		pool = NULL;
+	}
+	if (need && !pool) {
+		pool = new ThreadPool(nr_helpers + 1);
+	}
+}
+
+unsigned int Search::get_threads() const
+{
+	return nr_helpers + 1;
+}
+
+unsigned int Search::get_depthlimit() const
+{
+	return maxdepth;
+}
+
+/*
+ * Return the number of nodes searched by the last search, summed up over
+ * the main thread and all helper threads.
+ */
+unsigned long Search::get_nodes() const
+{
+	unsigned long n = nodes + nodes_quiesce;
+	for (unsigned int i=0; i<nr_helpers; i++) {
+		n += helpers[i]->nodes + helpers[i]->nodes_quiesce;
+	}
+	return n;
+}
+
 Evaluator * Search::get_evaluator() const
 {
 	return evaluator;
@@ -450,5 +610,68 @@ void Search::set_param(const std::string& name, const std::string& value)
 			printf("Illegal argument for parameter '%s': '%s'\n",
 					name.c_str(), value.c_str());
 		}
+	} else if (name == "smp") {
+		stop_thread();
+		if (value == "lazy") {
+			smp_mode = SMP_LAZY;
+		} else if (value == "root") {
+			smp_mode = SMP_ROOT;
+		} else if (value == "ybwc") {
+			smp_mode = SMP_YBWC;
+		} else {
+			printf("Illegal argument for parameter '%s': '%s'\n",
+					name.c_str(), value.c_str());
+			return;
+		}
+		update_pool();
+		printf("param_smp = %s\n", value.c_str());
+#ifdef USE_LMR
+	} else if (name == "lmr" || name == "lmr_depth"
+			|| name == "lmr_moves" || name == "lmr_div") {
+		unsigned int v;
+		if (sscanf(value.c_str(), "%u", &v) != 1
+				|| (name == "lmr_div" && v == 0)) {
+			printf("Illegal argument for parameter '%s': '%s'\n",
+					name.c_str(), value.c_str());
+			return;
+		}
+		if (name == "lmr") {
+			param_lmr = (v != 0);
+		} else if (name == "lmr_depth") {
+			param_lmr_depth = v;
+		} else if (name == "lmr_moves") {
+			param_lmr_moves = v;
+		} else {
+			param_lmr_div = v;
+			init_lmr();
+		}
+		printf("param_lmr = %u, param_lmr_depth = %u,"
+				" param_lmr_moves = %u, param_lmr_div = %u\n",
+				param_lmr ? 1 : 0, param_lmr_depth,
+				param_lmr_moves, param_lmr_div);
+#endif
+	} else {
+		printf("Unknown search parameter: '%s'\n", name.c_str());
+	}
+}
+
+#ifdef USE_LMR
+/*
+ * Compute the late move reductions. The reduction grows with the
+ * logarithm of both the remaining depth and the number of moves already
+ * searched at a node, and shrinks with param_lmr_div (in 1/100).
+ */
+void Search::init_lmr()
+{
+	for (unsigned int depth=0; depth<64; depth++) {
+		for (unsigned int moves=0; moves<64; moves++) {
+			double r = 0;
+			if (depth > 0 && moves > 0) {
+				r = 0.5 + log((double) depth) * log((double) moves)
+					* 100 / param_lmr_div;
+			}
+			lmr_reduction[depth][moves] = (unsigned char) MIN(r, 63);
+		}
 	}
 }
+#endif
@@ -33,6 +33,9 @@
 #endif
 #include <stdio.h>
 #include <string.h>
+#ifndef WIN32
+# include <unistd.h>
+#endif
 
 
 Shell::Shell()
@@ -56,6 +59,9 @@ Shell::Shell()
 	pawnhashtable = NULL;
 	evalcache = NULL;
 	search = new Search(this);
+
+	hashsize = 0;
+	hashshm_readonly = false;
 }
 
 Shell::~Shell()
@@ -177,10 +183,25 @@ void Shell::set_hashsize(unsigned long size)
 {
 	search->stop_thread();
 	
-	unsigned long entries = size / sizeof(HashEntry);
+	hashsize = size;
+	unsigned long entries = size / HashTable::SIZEOF_ENTRY;
 	if (entries > 0) {
 		delete hashtable;
-		hashtable = new HashTable(entries);
+		hashtable = NULL;
+		if (!hashshm_name.empty()) {
+			try {
+				hashtable = new HashTable(entries,
+						hashshm_name.c_str(),
+						hashshm_readonly);
+			} catch (HashTableException & e) {
+				printf("%s", e.get_msg().c_str());
+				printf("Failed to use shared hash table,"
+						" using a private one.\n");
+			}
+		}
+		if (!hashtable) {
+			hashtable = new HashTable(entries);
+		}
 		hashtable->print_info();
 	} else {
 		delete hashtable;
@@ -191,6 +212,21 @@ void Shell::set_hashsize(unsigned long size)
 	search->set_hashtable(hashtable);
 }
 
+/*
+ * Put the hash table into the POSIX shared memory object `name', to share
+ * it with other processes. NULL selects a private hash table. A table
+ * that already exists is replaced.
+ */
+void Shell::set_hashshm(const char * name, bool readonly)
+{
+	hashshm_name = name ? name : "";
+	hashshm_readonly = readonly;
+
+	if (hashtable) {
+		set_hashsize(hashsize);
+	}
+}
+
 /*
  * Set the size of the pawn hash table in bytes. 0 disables pawn hash table.
  */
@@ -239,6 +275,16 @@ void Shell::set_evalcachesize(unsigned long size)
 #endif
 }
 
+/*
+ * Set the number of search threads.
+ */
+void Shell::set_threads(unsigned int n)
+{
+	search->stop_thread();
+	search->set_threads(n);
+	printf("Search threads: %u\n", search->get_threads());
+}
+
 /*
  * Set the engine's name.
  */
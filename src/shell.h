@@ -70,6 +70,12 @@ class Shell
 	PawnHashTable * pawnhashtable;
 	EvaluationCache * evalcache;
 	Search * search;
+
+	/* Size of the hash table, and name of the shared memory
+	 * object to put it in, if any. */
+	unsigned long hashsize;
+	std::string hashshm_name;
+	bool hashshm_readonly;
 	Color myside;
 
 	bool quit;
@@ -91,8 +97,10 @@ class Shell
       public:
 	void set_book(const char * bookfile);
 	void set_hashsize(unsigned long size);
+	void set_hashshm(const char * name, bool readonly);
 	void set_pawnhashsize(unsigned long size);
 	void set_evalcachesize(unsigned long size);
+	void set_threads(unsigned int n);
 	void set_myname(const char * name);
 	void set_xboard(bool x);
 
@@ -156,17 +164,24 @@ class Shell
 	void cmd_echo();
 	void cmd_show();
 	void cmd_solve();
+	void cmd_match();
 	void cmd_bench();
+	void cmd_perft();
+	void cmd_divide();
 	void cmd_book();
 	void cmd_hash();
 	void cmd_pawnhash();
 	void cmd_evalcache();
+	void cmd_threads();
 	void cmd_set();
 	void cmd_get();
 	void cmd_playboth();
 	void cmd_loadgame();
 	void cmd_savegame();
 	void cmd_redo();
+
+      private:
+	void run_perft(bool divide);
 };
 
 #endif // SHELL_H
@@ -24,7 +24,10 @@
 #include "common.h"
 #include "shell.h"
 #include "bench.h"
+#include "match.h"
+#include "perft.h"
 #include "pgn.h"
+#include "solve.h"
 
 #include <errno.h>
 #include <stdio.h>
@@ -86,11 +89,15 @@ struct Shell::command Shell::commands[] = {
 	{ "echo",	&Shell::cmd_echo,	false,	""	},
 	{ "show",	&Shell::cmd_show,	false,	""	},
 	{ "solve",	&Shell::cmd_solve,	false,	""	},
+	{ "match",	&Shell::cmd_match,	false,	""	},
 	{ "bench",	&Shell::cmd_bench,	false,	""	},
+	{ "perft",	&Shell::cmd_perft,	false,	""	},
+	{ "divide",	&Shell::cmd_divide,	false,	""	},
 	{ "book",	&Shell::cmd_book,	false,	""	},
 	{ "hash",	&Shell::cmd_hash,	false,	""	},
 	{ "pawnhash",	&Shell::cmd_pawnhash,	false,	""	},
 	{ "evalcache",	&Shell::cmd_evalcache,	false,	""	},
+	{ "threads",	&Shell::cmd_threads,	false,	""	},
 	{ "set",	&Shell::cmd_set,	false,	""	},
 	{ "get",	&Shell::cmd_get,	false,	""	},
 	{ "playboth",	&Shell::cmd_playboth,	false,	""	},
@@ -591,6 +598,31 @@ void Shell::cmd_solve()
 	
 	CMD_REQUIRE_ARGS(1);
 	const char * filename = cmd_args[1].c_str();
+
+	/* With a number of jobs, solve that many positions at a time,
+	 * each with its own search and tables. */
+	if (cmd_args.size() > 2) {
+		unsigned int jobs;
+		if (sscanf(cmd_args[2].c_str(), "%u", &jobs) != 1
+				|| jobs < 1 || jobs > MAXTHREADS) {
+			printf("Usage: solve <epdfile> [jobs]\n");
+			return;
+		}
+
+		unsigned long pawnhashsize = pawnhashtable
+			? pawnhashtable->get_size() : 0;
+		unsigned long evalcachesize = evalcache
+			? evalcache->get_size() : 0;
+		Solver solver(this, jobs, hashtable
+				? hashsize / HashTable::SIZEOF_ENTRY : 0,
+				pawnhashsize, evalcachesize,
+				search->get_depthlimit(), &stop);
+		if (solver.read(filename)) {
+			log("solve: %s, %u jobs\n", filename, jobs);
+			solver.solve(game->get_clock());
+		}
+		return;
+	}
 	
 	FILE * fp;
 	if ((fp = fopen(filename, "r")) == NULL) {
@@ -688,6 +720,57 @@ void Shell::cmd_solve()
 	fclose(fp);
 }
 
+/* Number of random book moves of the openings of a match */
+#define MATCH_BOOK_PLIES	8
+
+void Shell::cmd_match()
+{
+	search->stop_thread();
+
+	unsigned int games, jobs;
+	if (cmd_args.size() < 4
+			|| sscanf(cmd_args[1].c_str(), "%u", &games) != 1
+			|| sscanf(cmd_args[2].c_str(), "%u", &jobs) != 1
+			|| games < 1 || jobs < 1 || jobs > MAXTHREADS) {
+		printf("Usage: match <games> <jobs> <pgnfile> [openings]"
+				" [name=value ...]\n");
+		return;
+	}
+	const char * pgnfile = cmd_args[3].c_str();
+
+	unsigned long pawnhashsize = pawnhashtable
+		? pawnhashtable->get_size() : 0;
+	unsigned long evalcachesize = evalcache ? evalcache->get_size() : 0;
+	Match match(this, jobs,
+			hashtable ? hashsize / HashTable::SIZEOF_ENTRY : 0,
+			pawnhashsize, evalcachesize,
+			search->get_depthlimit(), &stop);
+
+	/* Search parameters for player B */
+	const char * openings = NULL;
+	for (unsigned int i=4; i<cmd_args.size(); i++) {
+		std::string::size_type eq = cmd_args[i].find('=');
+		if (eq != std::string::npos) {
+			match.set_param(cmd_args[i].substr(0, eq),
+					cmd_args[i].substr(eq + 1));
+		} else {
+			openings = cmd_args[i].c_str();
+		}
+	}
+
+	if (openings) {
+		if (!match.read_openings(openings)) {
+			return;
+		}
+	} else if (!match.book_openings(book, (games + 1) / 2,
+				MATCH_BOOK_PLIES)) {
+		return;
+	}
+
+	log("match: %u games, %u jobs\n", games, jobs);
+	match.play(games, game->get_clock(), pgnfile);
+}
+
 void Shell::cmd_bench()
 {
 	search->stop_thread();
@@ -704,14 +787,106 @@ void Shell::cmd_bench()
 	} else if (type == "makemove") {
 		Bench bench;
 		bench.bench_makemove();
+	} else if (type == "search") {
+		unsigned int depth = 6;
+		if (cmd_args.size() >= 3
+				&& (sscanf(cmd_args[2].c_str(), "%u",
+						&depth) != 1
+					|| depth < 1)) {
+			printf("Illegal search depth: %s\n",
+					cmd_args[2].c_str());
+			return;
+		}
+		Bench bench;
+		bench.bench_search(search, depth);
+	} else if (type == "smp") {
+		unsigned int maxthreads = 16;
+		unsigned int depth = 8;
+		if (cmd_args.size() >= 3
+				&& (sscanf(cmd_args[2].c_str(), "%u",
+						&maxthreads) != 1
+					|| maxthreads < 1)) {
+			printf("Illegal number of threads: %s\n",
+					cmd_args[2].c_str());
+			return;
+		}
+		if (cmd_args.size() >= 4
+				&& (sscanf(cmd_args[3].c_str(), "%u",
+						&depth) != 1
+					|| depth < 1)) {
+			printf("Illegal search depth: %s\n",
+					cmd_args[3].c_str());
+			return;
+		}
+		Bench bench;
+		bench.bench_smp(search, hashtable, maxthreads, depth);
+	} else if (type == "pgn") {
+		CMD_REQUIRE_ARGS(2);
+		Bench bench;
+		bench.bench_pgn(cmd_args[2].c_str());
 	} else {
 		printf("Usage: bench movegen\n");
 		printf("       bench evaluator\n");
 		printf("       bench makemove\n");
+		printf("       bench search [<depth>]\n");
+		printf("       bench smp [<maxthreads> [<depth>]]\n");
+		printf("       bench pgn <pgnfile>\n");
 		return;
 	}
 }
 
+void Shell::cmd_perft()
+{
+	run_perft(false);
+}
+
+void Shell::cmd_divide()
+{
+	run_perft(true);
+}
+
+/*
+ * perft/divide <depth> [nobulk] [hash <size>]
+ *
+ * The root moves are split across as many threads as set with the
+ * threads command.
+ */
+void Shell::run_perft(bool divide)
+{
+	search->stop_thread();
+
+	const char * cmd = divide ? "divide" : "perft";
+	unsigned int depth;
+	bool bulk = true;
+	long hashsize = 0;
+
+	if (cmd_args.size() < 2
+			|| sscanf(cmd_args[1].c_str(), "%u", &depth) != 1) {
+		printf("Usage: %s <depth> [nobulk] [hash <size>]\n", cmd);
+		return;
+	}
+
+	for (unsigned int i = 2; i < cmd_args.size(); i++) {
+		if (cmd_args[i] == "nobulk") {
+			bulk = false;
+		} else if (cmd_args[i] == "hash" && i+1 < cmd_args.size()) {
+			const char * s = cmd_args[++i].c_str();
+			if (!parse_size(s, &hashsize) || hashsize < 0) {
+				printf("Illegal value for perft hash size: %s\n",
+						s);
+				return;
+			}
+		} else {
+			printf("Usage: %s <depth> [nobulk] [hash <size>]\n",
+					cmd);
+			return;
+		}
+	}
+
+	Perft perft(hashsize, bulk, search->get_threads());
+	perft.run(game->get_board(), depth, divide);
+}
+
 void Shell::cmd_book()
 {
 	CMD_REQUIRE_ARGS(1);
@@ -741,14 +916,48 @@ void Shell::cmd_book()
 			return;
 		}
 
+		unsigned int threads = search->get_threads();
+		long memsize;
+		if (!parse_size(DEFAULT_BOOKMEMSIZE, &memsize)) {
+			BUG("parse_size() failed for DEFAULT_BOOKMEMSIZE");
+		}
+		for (unsigned int i = 6; i < cmd_args.size(); i++) {
+			if (cmd_args[i] == "threads" && i+1 < cmd_args.size()) {
+				const char * s = cmd_args[++i].c_str();
+				if (sscanf(s, "%u", &threads) != 1
+						|| threads < 1) {
+					printf("Illegal number of threads: %s\n",
+							s);
+					return;
+				}
+			} else if (cmd_args[i] == "mem"
+					&& i+1 < cmd_args.size()) {
+				const char * s = cmd_args[++i].c_str();
+				if (!parse_size(s, &memsize) || memsize <= 0) {
+					printf("Illegal value for memory size:"
+							" %s\n", s);
+					return;
+				}
+			} else {
+				printf("Error: unknown argument `%s'\n",
+						cmd_args[i].c_str());
+				return;
+			}
+		}
+
 		printf("Creating opening book `%s' from `%s' ...\n",
 				destfile, srcfile);
-		Book::create_from_pgn(destfile, srcfile, depth, min_move_count);
+		if (!Book::create_from_pgn(destfile, srcfile, depth,
+					min_move_count, threads, memsize)) {
+			printf("Failed to create opening book `%s'.\n",
+					destfile);
+		}
 	} else {
 		printf("Usage: book close\n");
 		printf("       book open <bookfile>\n");
 		printf("       book create <bookfile> <pgnfile> <depth>"
-							" <min_move_count>\n");
+				" <min_move_count> [threads <n>]"
+				" [mem <size>]\n");
 	}
 }
 
@@ -798,12 +1007,38 @@ void Shell::cmd_hash()
 		} else {
 			printf("Error: hash table is disabled\n");
 		}
+	} else if (param == "shm" && cmd_args.size() == 3
+			&& cmd_args[2] == "off") {
+		search->stop_thread();
+		set_hashshm(NULL, false);
+	} else if (param == "shm" && cmd_args.size() == 4
+			&& cmd_args[2] == "remove") {
+		std::string error;
+		if (LargeMemory::remove_shared(cmd_args[3].c_str(), &error)) {
+			printf("Shared memory %s removed.\n",
+					cmd_args[3].c_str());
+		} else {
+			printf("%s", error.c_str());
+		}
+	} else if (param == "shm" && (cmd_args.size() == 3
+				|| (cmd_args.size() == 4
+					&& cmd_args[3] == "readonly"))) {
+		if (hashtable) {
+			search->stop_thread();
+			set_hashshm(cmd_args[2].c_str(), cmd_args.size() == 4);
+		} else {
+			printf("Error: hash table is disabled\n");
+		}
 	} else {
 		printf("Usage: hash clear\n");
 		printf("       hash size <size>\n");
 		printf("       hash off\n");
 		printf("       hash info\n");
 		printf("       hash stats\n");
+		printf("       hash replace <scheme>\n");
+		printf("       hash shm <name> [readonly]\n");
+		printf("       hash shm off\n");
+		printf("       hash shm remove <name>\n");
 	}
 }
 
@@ -908,6 +1143,21 @@ void Shell::cmd_evalcache()
 #endif
 }
 
+void Shell::cmd_threads()
+{
+	if (cmd_args.size() == 2) {
+		unsigned int n;
+		if (sscanf(cmd_args[1].c_str(), "%u", &n) != 1 || n < 1) {
+			printf("Illegal number of threads: %s\n",
+					cmd_args[1].c_str());
+			return;
+		}
+		set_threads(n);
+	} else {
+		printf("Search threads: %u\n", search->get_threads());
+	}
+}
+
 void Shell::cmd_set()
 {
 	CMD_REQUIRE_ARGS(1);
@@ -926,6 +1176,24 @@ void Shell::cmd_set()
 		const std::string& name = cmd_args[2];
 		const std::string& value = cmd_args[3];
 		search->get_evaluator()->set_param(name, value);
+#ifdef HOICHESS
+	} else if (cmd_args[1] == "sliders") {
+		CMD_REQUIRE_ARGS(2);
+		search->stop_thread();
+		if (!Bitboard::set_slider_backend(cmd_args[2])) {
+			printf("Slider attack backend not available: %s\n",
+					cmd_args[2].c_str());
+		}
+		printf("sliders = %s\n", Bitboard::get_slider_backend());
+	} else if (cmd_args[1] == "bitops") {
+		CMD_REQUIRE_ARGS(2);
+		search->stop_thread();
+		if (!Bitboard::set_bitops_backend(cmd_args[2])) {
+			printf("Bit operation backend not available: %s\n",
+					cmd_args[2].c_str());
+		}
+		printf("bitops = %s\n", Bitboard::get_bitops_backend());
+#endif
 	} else {
 		printf("Illegal argument to command 'set': '%s'\n",
 				cmd_args[1].c_str());
@@ -938,6 +1206,12 @@ void Shell::cmd_get()
 
 	if (cmd_args[1] == "myname") {
 		printf("myname = %s\n", myname.c_str());
+#ifdef HOICHESS
+	} else if (cmd_args[1] == "sliders") {
+		printf("sliders = %s\n", Bitboard::get_slider_backend());
+	} else if (cmd_args[1] == "bitops") {
+		printf("bitops = %s\n", Bitboard::get_bitops_backend());
+#endif
 #if 0
 	} else if (cmd_args[1] == "searchparam") {
 		//unsigned long features = search->get_features();
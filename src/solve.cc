@@ -0,0 +1,278 @@
+/* $Id$
+ *
+ * HoiChess/solve.cc
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "board.h"
+#include "pgn.h"
+#include "solve.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+
+/*
+ * The sizes of the tables are given in entries. They are divided among
+ * the jobs.
+ */
+Solver::Solver(Shell * shell, unsigned int nr_jobs, unsigned long hashsize,
+		unsigned long pawnhashsize, unsigned long evalcachesize,
+		unsigned int depthlimit, const bool * stop)
+{
+	ASSERT(nr_jobs > 0);
+	this->stop = stop;
+
+	for (unsigned int i=0; i<nr_jobs; i++) {
+		struct job job;
+		job.search = new Search(shell);
+		job.hashtable = (hashsize / nr_jobs > 0)
+			? new HashTable(hashsize / nr_jobs) : NULL;
+		job.pawnhashtable = (pawnhashsize / nr_jobs > 0)
+			? new PawnHashTable(pawnhashsize / nr_jobs) : NULL;
+		job.evalcache = NULL;
+#ifdef USE_EVALCACHE
+		if (evalcachesize / nr_jobs > 0) {
+			job.evalcache = new EvaluationCache(evalcachesize
+					/ nr_jobs);
+		}
+#else
+		(void) evalcachesize;
+#endif
+		job.search->set_hashtable(job.hashtable);
+		job.search->set_pawnhashtable(job.pawnhashtable);
+		job.search->set_evalcache(job.evalcache);
+		job.search->set_depthlimit(depthlimit);
+		jobs.push_back(job);
+	}
+
+	pool = new ThreadPool(nr_jobs);
+}
+
+Solver::~Solver()
+{
+	delete pool;
+	for (unsigned int i=0; i<jobs.size(); i++) {
+		delete jobs[i].search;
+		delete jobs[i].hashtable;
+		delete jobs[i].pawnhashtable;
+		delete jobs[i].evalcache;
+	}
+}
+
+/*
+ * Read all positions of an EPD file.
+ */
+bool Solver::read(const char * filename)
+{
+	FILE * fp;
+	if ((fp = fopen(filename, "r")) == NULL) {
+		printf("Cannot open %s: %s\n", filename, strerror(errno));
+		return false;
+	}
+
+	char buf[1024];
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+		if (strspn(buf, " \t\r\n") == strlen(buf)) {
+			continue;
+		}
+		EPD epd(buf);
+		struct position pos;
+		pos.solver = this;
+		pos.id = epd.get1("id");
+		pos.fen = epd.get_fen();
+		pos.bms = epd.get("bm");
+		pos.done = pos.bms.empty();
+		pos.searched = false;
+		pos.correct = false;
+		pos.csecs = 0;
+		pos.solve_csecs = 0;
+		pos.nodes = 0;
+		positions.push_back(pos);
+	}
+
+	fclose(fp);
+	return true;
+}
+
+/*
+ * Search all positions, each with the given clock. The positions are
+ * distributed among the jobs, which take over each other's positions
+ * when they run out of work.
+ */
+void Solver::solve(const Clock & clock)
+{
+	this->clock = clock;
+	next_print = 0;
+	right = 0;
+	total = 0;
+	skipped = 0;
+	nodes = 0;
+	csecs = 0;
+
+	printf("Solving %u positions with %u jobs...\n",
+			(unsigned int) positions.size(),
+			(unsigned int) jobs.size());
+
+	Clock wallclock;
+	wallclock.start();
+
+	for (unsigned int i=0; i<positions.size(); i++) {
+		if (!positions[i].bms.empty()) {
+			pool->submit(i % jobs.size(), position_task,
+					&positions[i]);
+		}
+	}
+	print_results();
+	pool->wait();
+
+	const unsigned int wall = wallclock.stop();
+
+	printf("--------------------------------------------------\n");
+	printf("Correct: %u of %u (%u%%), skipped: %u\n", right, total,
+			total > 0 ? 100 * right / total : 0, skipped);
+	if (wall > 0) {
+		printf("Time: %.2f s, search time of all jobs: %.2f s"
+				" (%.2f jobs busy on average)\n",
+				(float) wall / 100, (float) csecs / 100,
+				(float) csecs / wall);
+		printf("Throughput: %.1f positions/min, %.0fk nodes/s\n",
+				total * 6000.0 / wall,
+				nodes / ((float) wall / 100) / 1000);
+	}
+	log("solve finished: correct %u/%u, time %.2f s\n", right, total,
+			(float) wall / 100);
+}
+
+void Solver::position_task(void * arg, unsigned int worker)
+{
+	struct position * pos = (struct position *) arg;
+	pos->solver->search_position(pos, worker);
+}
+
+void Solver::search_position(struct position * pos, unsigned int worker)
+{
+	if (!*stop) {
+		/* Like the sequential solve, start each position with empty
+		 * tables, so that the result does not depend on which
+		 * positions the job has searched before. */
+		struct job * job = &jobs[worker];
+		if (job->hashtable) {
+			job->hashtable->clear();
+		}
+		if (job->pawnhashtable) {
+			job->pawnhashtable->clear();
+		}
+		if (job->evalcache) {
+			job->evalcache->clear();
+		}
+
+		Search * search = job->search;
+		Board board(pos->fen.c_str());
+
+		Clock timer;
+		timer.start();
+		search->start(board, clock, Search::MOVE);
+		pos->csecs = timer.stop();
+
+		Move mov = search->get_best();
+		pos->move = mov.san(board);
+		pos->solve_csecs = search->get_best_time();
+		pos->nodes = search->get_nodes();
+		for (std::list<std::string>::const_iterator it
+				= pos->bms.begin(); it != pos->bms.end(); it++) {
+			if (*it == pos->move) {
+				pos->correct = true;
+				break;
+			}
+		}
+		pos->searched = true;
+	}
+
+	mutex.lock();
+	pos->done = true;
+	mutex.unlock();
+
+	print_results();
+}
+
+/*
+ * Print the results of the positions that are done, as far as all
+ * positions before them are done, too.
+ */
+void Solver::print_results()
+{
+	mutex.lock();
+	while (next_print < positions.size() && positions[next_print].done) {
+		print_position(positions[next_print]);
+		next_print++;
+	}
+	fflush(stdout);
+	mutex.unlock();
+}
+
+void Solver::print_position(const struct position & pos)
+{
+	if (pos.bms.empty()) {
+		printf("--------------------------------------------------\n");
+		printf("[%s] %s\n", pos.id.c_str(), pos.fen.c_str());
+		printf("No best move associated to this position,"
+				" skipping.\n");
+		skipped++;
+		return;
+	} else if (!pos.searched) {
+		return;
+	}
+
+	printf("--------------------------------------------------\n");
+	printf("[%s] %s\n", pos.id.c_str(), pos.fen.c_str());
+	printf("Best move:");
+	for (std::list<std::string>::const_iterator it = pos.bms.begin();
+			it != pos.bms.end(); it++) {
+		printf(" %s", it->c_str());
+	}
+	printf("\n");
+
+	if (pos.correct) {
+		printf("My move: %s (correct), solved after %.2f s"
+				" of %.2f s, %lu nodes\n", pos.move.c_str(),
+				(float) pos.solve_csecs / 100,
+				(float) pos.csecs / 100, pos.nodes);
+		right++;
+	} else {
+		printf("My move: %s (incorrect), %.2f s, %lu nodes\n",
+				pos.move.c_str(), (float) pos.csecs / 100,
+				pos.nodes);
+	}
+	log("position: %s\tmove: %s\t(%s)\ttime: %.2f\tsolved: %.2f\n",
+			pos.id.c_str(), pos.move.c_str(),
+			pos.correct ? "correct" : "incorrect",
+			(float) pos.csecs / 100,
+			pos.correct ? (float) pos.solve_csecs / 100 : -1.0);
+
+	total++;
+	nodes += pos.nodes;
+	csecs += pos.csecs;
+	printf("Correct: %u of %u (%u%%), skipped: %u\n", right, total,
+			100 * right / total, skipped);
+}
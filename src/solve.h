@@ -0,0 +1,113 @@
+/* $Id$
+ *
+ * HoiChess/solve.h
+ *
+ * Copyright (C) 2004-2006 Holger Ruckdeschel <holger@hoicher.de>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#ifndef SOLVE_H
+#define SOLVE_H
+
+#include "common.h"
+#include "clock.h"
+#include "evalcache.h"
+#include "hash.h"
+#include "move.h"
+#include "pawnhash.h"
+#include "search.h"
+#include "thread.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+/* forward declaration */
+class Shell;
+
+
+/*****************************************************************************
+ *
+ * Class Solver
+ *
+ * Runs the positions of an EPD test suite on several independent searches
+ * in parallel, one per job. Each job has its own hash table, pawn hash
+ * table and evaluation cache, sized so that all jobs together use as much
+ * memory as the shell's tables. Results are printed in file order.
+ *
+ *****************************************************************************/
+
+class Solver
+{
+      private:
+	struct job {
+		Search * search;
+		HashTable * hashtable;
+		PawnHashTable * pawnhashtable;
+		EvaluationCache * evalcache;
+	};
+
+	struct position {
+		Solver * solver;
+		std::string id;
+		std::string fen;
+		std::list<std::string> bms;
+
+		/* Results, set by the job that has searched the position */
+		bool done;
+		bool searched;
+		bool correct;
+		std::string move;
+		unsigned int csecs;
+		unsigned int solve_csecs;
+		unsigned long nodes;
+	};
+
+      private:
+	const bool * stop;
+	Clock clock;
+	std::vector<struct job> jobs;
+	std::vector<struct position> positions;
+	ThreadPool * pool;
+
+	/* The following are protected by mutex. */
+	Mutex mutex;
+	unsigned int next_print;
+	unsigned int right;
+	unsigned int total;
+	unsigned int skipped;
+	unsigned long nodes;
+	unsigned int csecs;
+
+      public:
+	Solver(Shell * shell, unsigned int nr_jobs, unsigned long hashsize,
+			unsigned long pawnhashsize, unsigned long evalcachesize,
+			unsigned int depthlimit, const bool * stop);
+	~Solver();
+
+      public:
+	bool read(const char * filename);
+	void solve(const Clock & clock);
+
+      private:
+	static void position_task(void * arg, unsigned int worker);
+	void search_position(struct position * pos, unsigned int worker);
+	void print_results();
+	void print_position(const struct position & pos);
+};
+
+#endif // SOLVE_H
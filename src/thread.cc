@@ -0,0 +1,200 @@
+/* $Id$
+ *
+ * HoiChess/thread.cc
+ *
+ * Copyright (C) 2005 Holger Ruckdeschel <holger@hoicher.de>
+ * 
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ * 
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "common.h"
+#include "thread.h"
+
+
+/*****************************************************************************
+ *
+ * Member functions of class ThreadPool.
+ *
+ *****************************************************************************/
+
+ThreadPool::ThreadPool(unsigned int nr_workers)
+{
+	ASSERT(nr_workers > 0);
+	this->nr_workers = nr_workers;
+
+	queued = 0;
+	pending = 0;
+	idle = 0;
+	quit = false;
+
+	/* Worker 0 is the thread calling wait(). */
+	workers = new struct worker[nr_workers];
+	for (unsigned int i=0; i<nr_workers; i++) {
+		workers[i].pool = this;
+		workers[i].id = i;
+		workers[i].thread = NULL;
+	}
+	for (unsigned int i=1; i<nr_workers; i++) {
+		workers[i].thread = new Thread(thread_main);
+		workers[i].thread->start(&workers[i]);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	mutex.lock();
+	quit = true;
+	cond.broadcast();
+	mutex.unlock();
+
+	for (unsigned int i=1; i<nr_workers; i++) {
+		workers[i].thread->wait();
+		delete workers[i].thread;
+	}
+	delete[] workers;
+}
+
+/*
+ * Add a task to the queue of the given worker. It may be run by any
+ * worker, though.
+ */
+void ThreadPool::submit(unsigned int worker, task_func func, void * arg)
+{
+	ASSERT(worker < nr_workers);
+
+	struct task t;
+	t.func = func;
+	t.arg = arg;
+
+	mutex.lock();
+	workers[worker].mutex.lock();
+	workers[worker].queue.push_back(t);
+	workers[worker].mutex.unlock();
+	queued++;
+	pending++;
+	cond.broadcast();
+	mutex.unlock();
+}
+
+/*
+ * Number of pool threads that are waiting for tasks and would not get one
+ * of the tasks that are already queued.
+ */
+unsigned int ThreadPool::get_idle()
+{
+	mutex.lock();
+	const unsigned int n = (idle > queued) ? idle - queued : 0;
+	mutex.unlock();
+	return n;
+}
+
+/*
+ * Run tasks as worker 0 until all submitted tasks, including those
+ * submitted meanwhile, are finished.
+ */
+void ThreadPool::wait()
+{
+	struct task t;
+	for (;;) {
+		if (get_task(0, &t)) {
+			run_task(0, t);
+			continue;
+		}
+
+		mutex.lock();
+		while (pending > 0 && queued == 0) {
+			cond.wait(mutex);
+		}
+		const bool done = (pending == 0);
+		mutex.unlock();
+
+		if (done) {
+			break;
+		}
+	}
+}
+
+/*
+ * Take the newest task of the worker's own queue, or else the oldest
+ * task of another worker's queue, starting with the next worker.
+ */
+bool ThreadPool::get_task(unsigned int worker, struct task * t)
+{
+	bool found = false;
+	for (unsigned int i=0; i<nr_workers && !found; i++) {
+		struct worker * w = &workers[(worker + i) % nr_workers];
+		w->mutex.lock();
+		if (!w->queue.empty()) {
+			if (i == 0) {
+				*t = w->queue.back();
+				w->queue.pop_back();
+			} else {
+				*t = w->queue.front();
+				w->queue.pop_front();
+			}
+			found = true;
+		}
+		w->mutex.unlock();
+	}
+
+	if (found) {
+		mutex.lock();
+		queued--;
+		mutex.unlock();
+	}
+	return found;
+}
+
+void ThreadPool::run_task(unsigned int worker, const struct task & t)
+{
+	(*t.func)(t.arg, worker);
+
+	mutex.lock();
+	if (--pending == 0) {
+		cond.broadcast();
+	}
+	mutex.unlock();
+}
+
+void * ThreadPool::thread_main(void * arg)
+{
+	struct worker * w = (struct worker *) arg;
+	ThreadPool * pool = w->pool;
+
+	struct task t;
+	for (;;) {
+		if (pool->get_task(w->id, &t)) {
+			pool->run_task(w->id, t);
+			continue;
+		}
+
+		pool->mutex.lock();
+		pool->idle++;
+		while (!pool->quit && pool->queued == 0) {
+			pool->cond.wait(pool->mutex);
+		}
+		pool->idle--;
+		const bool quit = pool->quit;
+		pool->mutex.unlock();
+
+		if (quit) {
+			break;
+		}
+	}
+
+	return NULL;
+}
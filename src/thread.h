@@ -33,6 +33,8 @@
 # error no thread support is available
 #endif
 
+#include <deque>
+
 /*****************************************************************************
  *
  * Mutex Class
@@ -40,6 +42,8 @@
  *****************************************************************************/
 
 class Mutex {
+	friend class Condition;
+
       private:
 #if defined(HAVE_PTHREAD)
 	pthread_mutex_t mtx;
@@ -95,6 +99,92 @@ inline void Mutex::unlock()
 }
 
 
+/*****************************************************************************
+ *
+ * Condition Class
+ *
+ * A condition variable, used together with a Mutex. wait() must be called
+ * with the mutex locked, and so must signal() and broadcast() on Win32,
+ * where the waiters are counted under the mutex.
+ *
+ *****************************************************************************/
+
+class Condition {
+      private:
+#if defined(HAVE_PTHREAD)
+	pthread_cond_t cond;
+#elif defined(WIN32)
+	HANDLE sem;
+	unsigned int waiters;
+#endif
+
+      public:
+	inline Condition();
+	inline ~Condition();
+
+      public:
+	inline void wait(Mutex & mutex);
+	inline void signal();
+	inline void broadcast();
+};
+
+
+inline Condition::Condition()
+{
+#if defined(HAVE_PTHREAD)
+	pthread_cond_init(&cond, NULL);
+#elif defined(WIN32)
+	sem = CreateSemaphore(NULL, 0, 0x7fffffff, NULL);
+	waiters = 0;
+#endif
+}
+
+inline Condition::~Condition()
+{
+#if defined(HAVE_PTHREAD)
+	pthread_cond_destroy(&cond);
+#elif defined(WIN32)
+	CloseHandle(sem);
+#endif
+}
+
+inline void Condition::wait(Mutex & mutex)
+{
+#if defined(HAVE_PTHREAD)
+	pthread_cond_wait(&cond, &mutex.mtx);
+#elif defined(WIN32)
+	waiters++;
+	mutex.unlock();
+	WaitForSingleObject(sem, INFINITE);
+	mutex.lock();
+#endif
+}
+
+inline void Condition::signal()
+{
+#if defined(HAVE_PTHREAD)
+	pthread_cond_signal(&cond);
+#elif defined(WIN32)
+	if (waiters > 0) {
+		waiters--;
+		ReleaseSemaphore(sem, 1, NULL);
+	}
+#endif
+}
+
+inline void Condition::broadcast()
+{
+#if defined(HAVE_PTHREAD)
+	pthread_cond_broadcast(&cond);
+#elif defined(WIN32)
+	if (waiters > 0) {
+		ReleaseSemaphore(sem, waiters, NULL);
+		waiters = 0;
+	}
+#endif
+}
+
+
 /*****************************************************************************
  *
  * Thread Class
@@ -184,4 +274,67 @@ inline DWORD WINAPI Thread::win32_startfunc_wrapper(LPVOID arg)
 }
 #endif
 
+
+/*****************************************************************************
+ *
+ * ThreadPool Class
+ *
+ * A fixed set of workers with one task queue each. submit() adds a task to
+ * the queue of a given worker. A worker takes its newest task first, and
+ * when its own queue is empty, steals the oldest task of another worker.
+ * Worker 0 is the thread that calls wait(), which runs tasks until all
+ * submitted tasks are finished; the others are threads of the pool.
+ *
+ *****************************************************************************/
+
+class ThreadPool {
+      public:
+	typedef void (*task_func)(void * arg, unsigned int worker);
+
+      private:
+	struct task {
+		task_func func;
+		void * arg;
+	};
+
+	struct worker {
+		ThreadPool * pool;
+		unsigned int id;
+		Thread * thread;
+		Mutex mutex;
+		std::deque<struct task> queue;
+	};
+
+	unsigned int nr_workers;
+	struct worker * workers;
+
+	/* The following are protected by mutex. */
+	Mutex mutex;
+	Condition cond;
+	unsigned int queued;	/* tasks in the queues */
+	unsigned int pending;	/* tasks not finished yet */
+	unsigned int idle;	/* threads waiting for tasks */
+	bool quit;
+
+      public:
+	ThreadPool(unsigned int nr_workers);
+	~ThreadPool();
+
+      public:
+	inline unsigned int size() const;
+	unsigned int get_idle();
+	void submit(unsigned int worker, task_func func, void * arg);
+	void wait();
+
+      private:
+	bool get_task(unsigned int worker, struct task * t);
+	void run_task(unsigned int worker, const struct task & t);
+	static void * thread_main(void * arg);
+};
+
+inline unsigned int ThreadPool::size() const
+{
+	return nr_workers;
+}
+
 #endif // THREAD_H
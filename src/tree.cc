@@ -107,8 +107,10 @@ Move Node::next()
 		state = CAPTURES;
 
 	case CAPTURES:
+		/* Losing captures are left for BAD_CAPTURES, or are not
+		 * searched at all in quiescence search. */
 		ASSERT_DEBUG(captures_generated);
-		mov = pick();
+		mov = pick(ORDER_BAD_CAPTURE);
 		if (mov) {
 			return mov;
 		}
@@ -126,13 +128,21 @@ Move Node::next()
 		//state = SCORE_NONCAPTURES;
 	
 	case SCORE_NONCAPTURES:
+		/* The remaining (bad) captures were already scored. */
 		ASSERT_DEBUG(noncaptures_generated);
-		score_moves();
+		score_moves(true);
 		state = NONCAPTURES;
 
 	case NONCAPTURES:
 		ASSERT_DEBUG(noncaptures_generated);
-		mov = pick();
+		mov = pick(ORDER_BAD_CAPTURE);
+		if (mov) {
+			return mov;
+		}
+		state = BAD_CAPTURES;
+
+	case BAD_CAPTURES:
+		mov = pick(-INFTY);
 		if (mov) {
 			return mov;
 		}
@@ -155,7 +165,7 @@ Move Node::next()
 
 	case ESCAPES:
 		ASSERT_DEBUG(escapes_generated);
-		mov = pick();
+		mov = pick(-INFTY);
 		if (mov) {
 			return mov;
 		}
@@ -167,7 +177,7 @@ Move Node::next()
 		state = ALL;
 
 	case ALL:
-		mov = pick();
+		mov = pick(-INFTY);
 		if (mov) {
 			return mov;
 		}
@@ -181,9 +191,13 @@ Move Node::next()
 	return NO_MOVE;
 }
 
-Move Node::pick()
+/*
+ * Return the move with the highest score that has not been returned yet,
+ * or NO_MOVE if there is none with a score above minscore.
+ */
+Move Node::pick(int minscore)
 {
-	int score = -INFTY;
+	int score = minscore;
 	int m = -1;
 	for (unsigned int i=current_move_no+1; i<movelist.size(); i++) {
 		if (movelist[i] == hashmv) {
@@ -209,13 +223,18 @@ Move Node::pick()
 
 /*
  * Assign scores to moves. For root node, the score are set
- * by Search::search_root() using set_current_score().
+ * by Search::search_root() using set_current_score(). If skip_captures
+ * is set, captures keep the score they already have.
  */
-void Node::score_moves()
+void Node::score_moves(bool skip_captures)
 {
 	if (type == ROOT)
 		return;
 
+#ifdef USE_SEE
+	const Board & board = tree->get_board();
+#endif
+
 	for (unsigned int i=current_move_no+1; i<movelist.size(); i++) {
 		int score = 0;
 		Move mov = movelist[i];
@@ -230,20 +249,33 @@ void Node::score_moves()
 				|| mov.is_enpassant()
 #endif
 				) {
-			/* TODO This could be improved I think */
-			score += 10000
-				+ mat_values[mov.cap_ptype()]
-				- mat_values[mov.ptype()];
-#ifdef HOICHESS
-			if (mov.is_promotion()) {
-				score += mat_values[mov.promote_to()];
+			if (skip_captures) {
+				continue;
 			}
+#ifdef USE_SEE
+			/* Only captures of a less valuable piece (and
+			 * promotions) can lose material. */
+			int see = 0;
+			if (mat_values[mov.ptype()] > mov.mat_gain()
+#ifdef HOICHESS
+					|| mov.is_promotion()
 #endif
+					) {
+				see = board.see(mov);
+			}
+			if (see < 0) {
+				movelist.set_score(i, ORDER_BAD_CAPTURE + see);
+				continue;
+			}
+#endif // USE_SEE
+			/* Order by MVV/LVA */
+			score += ORDER_CAPTURE + mov.mat_gain()
+				- mat_values[mov.ptype()];
 		} else {
 #ifdef USE_KILLER
 			/* TODO This could be improved I think */
 			if (mov == killer1 || mov == killer2) {
-				score += 5000;
+				score += ORDER_KILLER;
 			}
 #endif
 #ifdef USE_HISTORY
@@ -358,4 +390,29 @@ void Tree::unmake_move()
 	current_ply--;
 }
 
+/*
+ * Set up this tree to continue the path of another tree from its root to
+ * node ply, where the board is given. Only the information about the nodes
+ * on the path that the search looks at (repetitions, null moves,
+ * recaptures) is copied.
+ */
+void Tree::copy_path(const Tree & src, unsigned int ply, const Board & board)
+{
+	ASSERT_DEBUG(ply <= src.current_ply);
+	for (unsigned int i=0; i<=ply; i++) {
+		nodes[i].hashkey = src.nodes[i].hashkey;
+		nodes[i].incheck = src.nodes[i].incheck;
+		nodes[i].material = src.nodes[i].material;
+		nodes[i].played_move = src.nodes[i].played_move;
+	}
+#ifdef USE_UNMAKE_MOVE
+	this->board = board;
+	this->rootboard = src.rootboard;
+#else
+	nodes[0].board = src.nodes[0].board;
+	nodes[ply].board = board;
+#endif
+	current_ply = ply;
+}
+
  
@@ -40,11 +40,20 @@ class Node {
 	enum node_state {
 		GEN_CAPTURES, SCORE_CAPTURES, CAPTURES,
 		GEN_NONCAPTURES, SCORE_NONCAPTURES, NONCAPTURES,
+		BAD_CAPTURES,
 		GEN_ESCAPES, SCORE_ESCAPES, ESCAPES,
 		SCORE_ALL, ALL,
 		DONE
 	};
 	
+	/* Move ordering scores. Captures that lose material (by static
+	 * exchange evaluation) are scored below all non-captures. */
+	enum move_order {
+		ORDER_CAPTURE = 10000,
+		ORDER_KILLER = 5000,
+		ORDER_BAD_CAPTURE = -10000
+	};
+	
       private:
 	Tree * tree;	
 #ifdef USE_UNMAKE_MOVE
@@ -76,9 +85,9 @@ class Node {
       public:
 	Move first();
 	Move next();
-	Move pick();
+	Move pick(int minscore);
 
-	void score_moves();
+	void score_moves(bool skip_captures = false);
 
 	inline Hashkey get_hashkey() const;
 	inline bool in_check() const;
@@ -89,6 +98,7 @@ class Node {
 	inline Move get_current_move() const;
 
 	inline void set_current_score(int score);
+	inline void set_move_score(unsigned int i, int score);
 	
 	inline enum node_type get_type() const;
 	inline void set_type(enum node_type t);
@@ -101,6 +111,7 @@ class Node {
 
 	inline void set_historytable(HistoryTable * ht);
 	inline void add_killer(Move mov);
+	inline bool is_killer(Move mov) const;
 	inline Move get_played_move() const;
 };
 
@@ -122,6 +133,7 @@ class Tree {
 	void set_root(const Board & board);
 	Node * make_move(Move mov);
 	void unmake_move();
+	void copy_path(const Tree & src, unsigned int ply, const Board & board);
 
 	inline Node * operator[](unsigned int ply);
 	inline const Node * operator[](unsigned int ply) const;
@@ -173,6 +185,15 @@ inline void Node::set_current_score(int score)
 	movelist.set_score(current_move_no, score);
 }
 
+/*
+ * Set the score of the i-th move that has been returned by first() and
+ * next(), for moves that are searched out of order.
+ */
+inline void Node::set_move_score(unsigned int i, int score)
+{
+	movelist.set_score(i, score);
+}
+
 inline enum Node::node_type Node::get_type() const
 {
 	return type;
@@ -217,6 +238,11 @@ inline void Node::add_killer(Move mov)
 	}
 }
 
+inline bool Node::is_killer(Move mov) const
+{
+	return (mov == killer1 || mov == killer2);
+}
+
 inline Move Node::get_played_move() const
 {
 	return played_move;
@@ -116,7 +116,10 @@ bool parse_size(const char * s, long * n)
 
 	long tmp;
 	
-	if (s[strlen(s)-1] == 'M' && sscanf(s, "%ldM", &tmp) == 1) {
+	if (s[strlen(s)-1] == 'G' && sscanf(s, "%ldG", &tmp) == 1) {
+		*n = tmp * (1L<<30);
+		return true;
+	} else if (s[strlen(s)-1] == 'M' && sscanf(s, "%ldM", &tmp) == 1) {
 		*n = tmp * (1<<20);
 		return true;
 	} else if (s[strlen(s)-1] == 'K' && sscanf(s, "%ldK", &tmp) == 1) {
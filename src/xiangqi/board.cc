@@ -62,6 +62,11 @@ void Board::clear()
 	for (Square sq = A0; sq <= I9; sq++) {
 		pce_movecnt[sq] = 0;
 	}
+
+	pst_score[WHITE] = 0;
+	pst_score[BLACK] = 0;
+	movecnt_score[WHITE] = 0;
+	movecnt_score[BLACK] = 0;
 	
 	hashkey = NULLHASHKEY;
 	pawnhashkey = NULLHASHKEY;
@@ -81,6 +86,8 @@ void Board::make_move(Move mov)
 	hist.oldboard = *this;
 #endif
 	hist.move = mov;
+	hist.hashkey = hashkey;
+	hist.pawnhashkey = pawnhashkey;
 #endif // USE_UNMAKE_MOVE
 	
 	/* Move pieces */
@@ -98,10 +105,6 @@ void Board::make_move(Move mov)
 		BUG("unknown move flags: %x", mov.flags());
 	}
 
-#ifdef USE_UNMAKE_MOVE
-	hist.flags = flags;
-#endif
-	
 	/* Switch sides and update moveno */
 	switch_sides();
 	if (side == WHITE) {
@@ -126,6 +129,8 @@ void Board::make_move(Move mov)
 #endif
 		pce_movecnt[mov.to()] = pce_movecnt[mov.from()] + 1;
 		pce_movecnt[mov.from()] = 0;
+		/* sides are already switched */
+		movecnt_score[opponent] -= 2;
 	}
 	
 
@@ -137,6 +142,11 @@ void Board::make_move(Move mov)
 }
 
 #ifdef USE_UNMAKE_MOVE
+/*
+ * Take back a move made by make_move(). Only the pieces are moved back
+ * here, the hash keys and counters are restored from the history record,
+ * and material and piece-square table sums are restored incrementally.
+ */
 void Board::unmake_move(const BoardHistory & hist)
 {
 	Move mov = hist.move;
@@ -145,6 +155,7 @@ void Board::unmake_move(const BoardHistory & hist)
 	if (!mov.is_null()) {
 		pce_movecnt[mov.from()] = pce_movecnt[mov.to()] - 1;	
 		pce_movecnt[mov.to()] = hist.pce_movecnt_to;
+		movecnt_score[opponent] += 2;
 	}
 	
 	/* Restore movecnt50 */
@@ -154,15 +165,21 @@ void Board::unmake_move(const BoardHistory & hist)
 	if (side == WHITE) {
 		moveno--;
 	}
-	switch_sides();
+	side = XSIDE(side);
+	opponent = XSIDE(opponent);
+
+	/* Restore hash keys */
+	hashkey = hist.hashkey;
+	pawnhashkey = hist.pawnhashkey;
 
 	/* Move back pieces */
 	if (mov.is_capture()) {
-		move_piece(mov.to(), mov.from(), side, mov.ptype());
-		place_piece(mov.to(), opponent, mov.cap_ptype());
+		move_piece_raw(mov.to(), mov.from(), side, mov.ptype());
+		place_piece_raw(mov.to(), opponent, mov.cap_ptype());
+		material[opponent] += mat_values[mov.cap_ptype()];
 	}
 	else if (mov.is_normal()) {
-		move_piece(mov.to(), mov.from(), side, mov.ptype());
+		move_piece_raw(mov.to(), mov.from(), side, mov.ptype());
 	}
 	else if (mov.is_null()) {
 		/* nothing */
@@ -272,15 +289,7 @@ void Board::switch_sides()
 
 void Board::place_piece(Square sq, Color side, Piece ptype)
 {
-	ASSERT_DEBUG(color_at(sq) == NO_COLOR);
-	ASSERT_DEBUG(piece_at(sq) == NO_PIECE);
-	
-	position_pieces[sq] = ptype;
-	position_colors[sq] = side;
-	
-	if (ptype == KING) {
-		king[side] = sq;
-	}
+	place_piece_raw(sq, side, ptype);
 	
 	material[side] += mat_values[ptype];
 	
@@ -292,15 +301,7 @@ void Board::place_piece(Square sq, Color side, Piece ptype)
 
 void Board::remove_piece(Square sq, Color side, Piece ptype)
 {
-	ASSERT_DEBUG(color_at(sq) == side);
-	ASSERT_DEBUG(piece_at(sq) == ptype);
-	
-	position_pieces[sq] = NO_PIECE;
-	position_colors[sq] = NO_COLOR;
-
-	if (ptype == KING) {
-		king[side] = NO_SQUARE;
-	}
+	remove_piece_raw(sq, side, ptype);
 	
 	material[side] -= mat_values[ptype];
 	
@@ -312,19 +313,7 @@ void Board::remove_piece(Square sq, Color side, Piece ptype)
 	
 void Board::move_piece(Square from, Square to, Color side, Piece ptype)
 {
-	ASSERT_DEBUG(color_at(from) == side);
-	ASSERT_DEBUG(piece_at(from) == ptype);
-	ASSERT_DEBUG(color_at(to) == NO_COLOR);
-	ASSERT_DEBUG(piece_at(to) == NO_PIECE);
-
-	position_pieces[from] = NO_PIECE;
-	position_colors[from] = NO_COLOR;
-	position_pieces[to] = ptype;
-	position_colors[to] = side;
-	
-	if (ptype == KING) {
-		king[side] = to;
-	}
+	move_piece_raw(from, to, side, ptype);
 	
 	hashkey ^= hashkeys[side][ptype][from];
 	hashkey ^= hashkeys[side][ptype][to];
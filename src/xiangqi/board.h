@@ -57,6 +57,14 @@ class Board
 
 	unsigned int	pce_movecnt[90];
 
+	/* Sum of the piece-square table values of each side's pieces */
+	int		pst_score[2];
+
+	/* Sum of -2 * (pce_movecnt - 1) over each side's pieces. The
+	 * evaluator uses this to penalize moving the same pieces again
+	 * and again in the opening. */
+	int		movecnt_score[2];
+
 	Hashkey 	hashkey;
 	Hashkey 	pawnhashkey;
 
@@ -118,6 +126,10 @@ class Board
 	void place_piece(Square sq, Color side, Piece ptype);
 	void remove_piece(Square sq, Color side, Piece ptype);
 	void move_piece(Square from, Square to, Color side, Piece ptype);
+	inline void place_piece_raw(Square sq, Color side, Piece ptype);
+	inline void remove_piece_raw(Square sq, Color side, Piece ptype);
+	inline void move_piece_raw(Square from, Square to, Color side,
+			Piece ptype);
 //	void set_flag(unsigned int flag);
 //	void clear_flag(unsigned int flag);
       public:
@@ -145,6 +157,7 @@ class Board
       public:
 	bool is_attacked(Square to, Color atkside) const;
 	bool kings_facing() const;
+	int see(Move mov) const;
 	
 	/* Move generation functions, defined in board_generate.cc */
       public:
@@ -185,6 +198,7 @@ class Board
 	Move parse_move(const std::string & str) const;
 	Move parse_move_1(const std::string & str) const;
 	Move do_parse_move_1(const std::string & str) const;
+	Move parse_san(const char * s, unsigned int len) const;
 	bool operator==(const Board & board) const;     
 
 	
@@ -193,6 +207,10 @@ class Board
 	static Hashkey hashkeys[2][7][90];
 	static Hashkey hash_side;
 
+	/* Piece-square tables, indexed by color, piece and square. They are
+	 * filled by Evaluator::init(). */
+	static int pst[2][7][90];
+
 	/* Static Member Functions */
       public:
 	static void init();
@@ -201,6 +219,8 @@ class Board
 #ifdef USE_UNMAKE_MOVE
 /* 
  * This class contains all necessary information to unmake a previous move.
+ * It is kept small, since the search stores one per ply instead of a copy
+ * of the board.
  */
 class BoardHistory
 {
@@ -211,10 +231,11 @@ class BoardHistory
 	 * was correctly restored. */
 	Board oldboard;
 #endif
+	Hashkey hashkey;
+	Hashkey pawnhashkey;
 	Move move;
-	int movecnt50;
-//	unsigned int flags;
 	unsigned int pce_movecnt_to;
+	int movecnt50;
 };
 #endif
 
@@ -252,6 +273,63 @@ inline unsigned int Board::get_pce_movecnt(Square sq) const
 	return pce_movecnt[sq];
 }
 
+/*
+ * Like place_piece(), remove_piece() and move_piece(), but without
+ * updating material and hash keys. The piece-square table sums are
+ * updated here, so that unmake_move() restores them as well.
+ */
+inline void Board::place_piece_raw(Square sq, Color side, Piece ptype)
+{
+	ASSERT_DEBUG(color_at(sq) == NO_COLOR);
+	ASSERT_DEBUG(piece_at(sq) == NO_PIECE);
+	
+	position_pieces[sq] = ptype;
+	position_colors[sq] = side;
+
+	pst_score[side] += pst[side][ptype][sq];
+	movecnt_score[side] -= 2 * ((int) pce_movecnt[sq] - 1);
+	
+	if (ptype == KING) {
+		king[side] = sq;
+	}
+}
+
+inline void Board::remove_piece_raw(Square sq, Color side, Piece ptype)
+{
+	ASSERT_DEBUG(color_at(sq) == side);
+	ASSERT_DEBUG(piece_at(sq) == ptype);
+	
+	position_pieces[sq] = NO_PIECE;
+	position_colors[sq] = NO_COLOR;
+
+	pst_score[side] -= pst[side][ptype][sq];
+	movecnt_score[side] += 2 * ((int) pce_movecnt[sq] - 1);
+
+	if (ptype == KING) {
+		king[side] = NO_SQUARE;
+	}
+}
+
+inline void Board::move_piece_raw(Square from, Square to, Color side,
+		Piece ptype)
+{
+	ASSERT_DEBUG(color_at(from) == side);
+	ASSERT_DEBUG(piece_at(from) == ptype);
+	ASSERT_DEBUG(color_at(to) == NO_COLOR);
+	ASSERT_DEBUG(piece_at(to) == NO_PIECE);
+
+	position_pieces[from] = NO_PIECE;
+	position_colors[from] = NO_COLOR;
+	position_pieces[to] = ptype;
+	position_colors[to] = side;
+
+	pst_score[side] += pst[side][ptype][to] - pst[side][ptype][from];
+	
+	if (ptype == KING) {
+		king[side] = to;
+	}
+}
+
 inline bool Board::in_check() const
 {
 	return kings_facing() || is_attacked(get_king(side), opponent);
@@ -335,27 +335,131 @@ unsigned int Board::king_attacks(Square from, Color side, Square tos[])
  * 
  *****************************************************************************/
 
+/*
+ * Instead of generating the attacker's moves, look outward from the target
+ * square for each piece type that could attack it. Mind that the attack
+ * directions of horses and pawns are not symmetric, so the tables are used
+ * in reverse.
+ */
+
+#define PIECE_AT(t, pce) \
+	(map[t] != NO_SQUARE && position_colors[map[t]] == atkside \
+	 && position_pieces[map[t]] == (pce))
+
 bool Board::is_attacked(Square to, Color atkside) const
 {
-	/* TODO this is just a quick'n'dirty implementation */
-	
-	Board b = *this;
-	if (atkside != b.get_side()) {
-		b.make_move(Move::null());
+	const int f = invmap[to];
+	int t;
+
+	/* rooks and cannons */
+	for (unsigned int i=0; i<4; i++) {
+		t = f + dir_rook[i];
+		while (map[t] != NO_SQUARE && position_colors[map[t]] == NO_COLOR) {
+			t += dir_rook[i];
+		}
+		if (map[t] == NO_SQUARE) {
+			continue;
+		}
+		if (PIECE_AT(t, ROOK)) {
+			return true;
+		}
+
+		/* t is the cannon's screen */
+		t += dir_cannon[i];
+		while (map[t] != NO_SQUARE && position_colors[map[t]] == NO_COLOR) {
+			t += dir_cannon[i];
+		}
+		if (PIECE_AT(t, CANNON)) {
+			return true;
+		}
 	}
-	
-	Movelist movelist;
-	b.generate_moves(&movelist);
-	for (unsigned int i=0; i<movelist.size(); i++) {
-		Move mov = movelist[i];
-		if (mov.to() == to) {
+
+	/* horses: the leg is next to the horse, not to the target */
+	for (unsigned int i=0; i<8; i++) {
+		t = f - dir_knight[i];
+		if (PIECE_AT(t, KNIGHT)
+				&& position_colors[map[t + free_knight[i]]]
+					== NO_COLOR) {
 			return true;
 		}
 	}
-	
+
+	/* pawns */
+	if (atkside == WHITE) {
+		if (PIECE_AT(f - 13, PAWN)) {
+			return true;
+		}
+		if (RNK(to) >= RANK5
+				&& (PIECE_AT(f - 1, PAWN) || PIECE_AT(f + 1, PAWN))) {
+			return true;
+		}
+	} else {
+		if (PIECE_AT(f + 13, PAWN)) {
+			return true;
+		}
+		if (RNK(to) <= RANK4
+				&& (PIECE_AT(f - 1, PAWN) || PIECE_AT(f + 1, PAWN))) {
+			return true;
+		}
+	}
+
+	/* elephants: both squares must be in the elephant's half */
+	const Square * map_half = (atkside == WHITE)
+		? map_whitehalf : map_blackhalf;
+	if (map_half[f] != NO_SQUARE) {
+		for (unsigned int i=0; i<4; i++) {
+			t = f - dir_elephant[i];
+			if (map_half[t] != NO_SQUARE && PIECE_AT(t, ELEPHANT)
+					&& position_colors[map[f - free_elephant[i]]]
+						== NO_COLOR) {
+				return true;
+			}
+		}
+	}
+
+	/* guards and king: both squares must be in the palace */
+	if (map_palace[f] != NO_SQUARE) {
+		for (unsigned int i=0; i<4; i++) {
+			t = f - dir_guard[i];
+			if (map_palace[t] != NO_SQUARE && PIECE_AT(t, GUARD)) {
+				return true;
+			}
+			t = f - dir_king[i];
+			if (map_palace[t] != NO_SQUARE && PIECE_AT(t, KING)) {
+				return true;
+			}
+		}
+	}
+
+	/* facing kings */
+	if (to == king[XSIDE(atkside)] && kings_facing()) {
+		return true;
+	}
+
 	return false;
 }
 
+#undef PIECE_AT
+
+/*****************************************************************************
+ * 
+ * Static exchange evaluation, simplified: Returns the material gained by
+ * 'mov', minus the value of the moving piece if it is worth more than the
+ * captured piece and the target square is defended. Unlike in chess, there
+ * are no attack bitboards here to play out the whole exchange.
+ * 
+ *****************************************************************************/
+
+int Board::see(Move mov) const
+{
+	int gain = mov.mat_gain();
+	if (mat_values[mov.ptype()] > gain
+			&& is_attacked(mov.to(), opponent)) {
+		gain -= mat_values[mov.ptype()];
+	}
+	return gain;
+}
+
 /*****************************************************************************
  * 
  * Returns true if the two kings are facing each other, i.e. they are on the
@@ -28,6 +28,7 @@
 
 Hashkey Board::hashkeys[2][7][90];
 Hashkey Board::hash_side;
+int Board::pst[2][7][90];
 
 
 void Board::init()
@@ -734,6 +734,17 @@ Move Board::do_parse_move_1(const std::string & str) const
 }
 
 
+/*
+ * Parse a move from a PGN file (see PGNReader). s need not be
+ * null-terminated. There is no fast path for Xiangqi yet, so this just
+ * calls parse_move_1(). The caller must check Board::is_legal() after
+ * making the move, as in chess.
+ */
+Move Board::parse_san(const char * s, unsigned int len) const
+{
+	return parse_move_1(std::string(s, len));
+}
+
 bool Board::operator==(const Board & board) const
 {
 	for (Square sq = A0; sq <= I9; sq++) {
@@ -23,6 +23,7 @@
 
 #include "common.h"
 #include "eval.h"
+#include "evalplugins.h"
 #include "board.h"
 
 /*****************************************************************************
@@ -67,6 +68,18 @@ unsigned int Evaluator::get_phase(const Board & board)
 	}
 }
 
+/*
+ * Material score from the side to move's point of view. There are no
+ * recognized endgames, so this never is the final score.
+ */
+bool Evaluator::eval_material(const Board & board, int * score)
+{
+	const Color side = board.get_side();
+	*score = material_balance(board.get_material(side),
+			board.get_material(XSIDE(side)));
+	return false;
+}
+
 void Evaluator::setup(const Board * board)
 {
 	ASSERT_DEBUG(board != NULL);
@@ -115,17 +128,51 @@ void Evaluator::finish()
  *****************************************************************************/
 
 const struct score_plugin Evaluator::plugins[] = {
-	{ "positional",	&Evaluator::score_positional	},
+	{ "positional",	&Evaluator::score_positional,	200, false },
+//	{ "control",	&Evaluator::score_control,	0, true },
 
-	{ NULL, NULL }
+	{ NULL, NULL, 0, false }
 };
 
-const struct score_plugin Evaluator::plugins2[] = {
-//	{ "control",	&Evaluator::score_control	},
+unsigned int Evaluator::run_plugins(Color side, int * score,
+		int alpha, int beta)
+{
+	/* Same order as plugins[] */
+	typedef PluginList<&Evaluator::score_positional,
+		PluginListEnd> List;
+	ASSERT_DEBUG(List::matches(plugins));
+
+	if (side == WHITE) {
+		return List::run<WHITE, 0>(this, score, alpha, beta);
+	} else {
+		return List::run<BLACK, 0>(this, score, alpha, beta);
+	}
+}
 
-	{ NULL, NULL }
-};
 
+void Evaluator::init()
+{
+	init_pst();
+}
+
+/*
+ * Fill the piece-square tables of class Board from positional_scores[].
+ * Board keeps the sums up to date while pieces are moved, so that
+ * score_positional() does not need to look at the pieces at all.
+ */
+void Evaluator::init_pst()
+{
+	for (int c = WHITE; c <= BLACK; c++) {
+		for (Square sq = A0; sq <= I9; sq++) {
+			const Square idx = (c == WHITE) ? sq
+				: SQUARE(XRANK(RNK(sq)), FIL(sq));
+
+			for (int p = PAWN; p <= KING; p++) {
+				Board::pst[c][p][sq] = positional_scores[p][idx];
+			}
+		}
+	}
+}
 
 const int Evaluator::positional_scores[][90] = {
 	{ // PAWN
@@ -223,24 +270,11 @@ const int Evaluator::positional_scores[][90] = {
 
 int Evaluator::score_positional(Color side)
 {
-	int score = 0;
-
-	for (Square sq=A0; sq<=I9; sq++) {
-		if (board->color_at(sq) != side) {
-			continue;
-		}
+	int score = board->pst_score[side];
 
-		Piece ptype = board->piece_at(sq);
-	
-		/* positional score */
-		Square idx = (side == WHITE) ? sq
-	                        : SQUARE(XRANK(RNK(sq)), FIL(sq));
-		score += positional_scores[ptype][idx];
-
-		/* penalize repetition during opening phase */
-		if (phase == OPENING) {
-			score += - (board->get_pce_movecnt(sq)-1)*2;
-		}
+	/* penalize repetition during opening phase */
+	if (phase == OPENING) {
+		score += board->movecnt_score[side];
 	}
 	
 	return score;
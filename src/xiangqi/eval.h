@@ -44,9 +44,16 @@ class Evaluator
 		ENDGAME
 	};
 
+	template <int (Evaluator::*)(Color), class> friend struct PluginList;
+
       private:
+	enum { MAX_PLUGINS = 16 };
 	static const struct score_plugin plugins[];
-	static const struct score_plugin plugins2[];
+	unsigned int nr_plugins;
+	/* Sum of the margins of the plugins after plugins[i] */
+	int margin_left[MAX_PLUGINS];
+	/* Position of the first phase 2 plugin in plugins[] */
+	unsigned int phase2_start;
 
       private:
 	PawnHashTable * pawnhashtable;
@@ -54,13 +61,15 @@ class Evaluator
 
 #ifdef COLLECT_STATISTICS
 	unsigned long stat_evals;
-	unsigned long stat_evals_phase1;
-	unsigned long stat_evals_phase2;
+	unsigned long stat_evals_material;
+	unsigned long stat_evals_cache;
+	unsigned long stat_evals_plugin[MAX_PLUGINS];
 #endif
 
       private:
 	const Board * board;
 	unsigned int phase;
+	int material_score;
 	Color myside;
 	PawnHashEntry pawnhashentry;
 	//Bitboard passed_pawns[2];
@@ -82,10 +91,17 @@ class Evaluator
 	void set_param(const std::string& name, const std::string& value);
 	
       private:
+	bool eval_material(const Board & board, int * score);
+	inline int scale_score(int score, Color side) const;
+	inline bool lazy_cutoff(int score, int margin, Color side,
+			int alpha, int beta) const;
+	inline bool phase1_cutoff(int score) const;
+	unsigned int run_plugins(Color side, int * score, int alpha, int beta);
 	void setup(const Board * board);
 	void finish();
 	
       public:
+	static void init();
 	static bool is_draw(const Board & board);
 	static int material_balance(int mat_side, int mat_xside);
 	static unsigned int get_phase(const Board & board);
@@ -94,12 +110,26 @@ class Evaluator
 	static const int positional_scores[7][90];
 
       private:
+	static void init_pst();
 	int score_positional(Color side);
 };
 
+inline int Evaluator::scale_score(int score, Color side) const
+{
+	(void) side;
+	return score;
+}
+
 struct score_plugin {
 	const char * name;
 	int (Evaluator::* func)(Color);
+
+	/* Maximum difference between func(side) and func(xside) */
+	int margin;
+
+	/* Phase 2 plugins are only called if the score of the plugins
+	 * before them is small, see Evaluator::phase1_cutoff() */
+	bool phase2;
 };
 
 #endif // EVAL_H